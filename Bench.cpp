@@ -0,0 +1,122 @@
+/**
+ * @file Bench.cpp
+ * @author Greg Loose (gloose)
+ * @brief A repeatable benchmark of the search, run with -b. Each position
+ * file given on the command line is searched to the same fixed depth, from an
+ * empty transposition table and a fresh board, so that runs can be compared
+ * with each other. The results are written by process 0 to standard output
+ * as JSON, with the totals for each position and a breakdown per process:
+ *
+ * {"ranks": 4, "threads": 1, "depth": 5, "dynamic": false,
+ *  "positions": [{"file": "inputs/london.txt", "bestMove": "Nb1c3",
+ *    "score": 0.61, "time": 1.2, "nodes": 2345678, "nps": 1954731,
+ *    "reduceTime": 0.1, "idleTime": 0,
+ *    "perRank": [{"nodes": 600000, "reduceTime": 0.1, "idleTime": 0}, ...]},
+ *   ...],
+ *  "totalTime": 8.4, "totalNodes": 16000000, "nps": 1904761}
+ *
+ * Times are in seconds. time is how long the search took to reach the given
+ * depth, and reduceTime and idleTime are the most any one process spent
+ * combining results and waiting for other processes, respectively (see
+ * SearchStats.h). bench.py runs this
+ * with different numbers of processes and works out the speedup.
+ *
+ * @date 2022-05-04
+ */
+
+#include "Bench.h"
+#include <iostream>
+
+void runBench(std::vector<char*>& files, int depth, bool dynamicScheduling, int numThreads, LazySMP* threads, TranspositionTable* table, Trace* trace, MPI_Comm comm) {
+    int procID;
+    int nproc;
+    MPI_Comm_rank(comm, &procID);
+    MPI_Comm_size(comm, &nproc);
+
+    if (procID == 0) {
+        std::cout << "{\"ranks\": " << nproc << ", \"threads\": " << numThreads << ", \"depth\": " << depth
+                  << ", \"dynamic\": " << (dynamicScheduling ? "true" : "false") << "," << std::endl;
+        std::cout << " \"positions\": [" << std::endl;
+    }
+
+    double totalTime = 0;
+    long totalNodes = 0;
+    bool first = true;
+
+    for (int f = 0; f < files.size(); f ++) {
+        Board* board = new Board();
+        board->setDynamicScheduling(dynamicScheduling);
+        board->setTranspositionTable(table);
+        board->setThreads(threads);
+        board->setTrace(trace);
+
+        Color toMove;
+        if (!board->readFile(files[f], toMove, comm)) {
+            if (procID == 0) {
+                std::cerr << "Skipping " << files[f] << ": first line must be W or B" << std::endl;
+            }
+            delete board;
+            continue;
+        }
+
+        if (table != NULL) {
+            table->reset();
+        }
+
+        MPI_Barrier(comm);
+        double startTime = MPI_Wtime();
+        std::pair<Move, double> best = board->searchRoot(depth, toMove, comm);
+        double elapsed = MPI_Wtime() - startTime;
+
+        double time;
+        MPI_Reduce(&elapsed, &time, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+        SearchStats& stats = board->getStats();
+        long nodes = stats.nodes + stats.quiescenceNodes;
+        double reduceTime = stats.commTime;
+        double idleTime = stats.waitTime + stats.idleTime;
+        std::vector<long> rankNodes(nproc);
+        std::vector<double> rankReduceTimes(nproc);
+        std::vector<double> rankIdleTimes(nproc);
+        MPI_Gather(&nodes, 1, MPI_LONG, &rankNodes[0], 1, MPI_LONG, 0, comm);
+        MPI_Gather(&reduceTime, 1, MPI_DOUBLE, &rankReduceTimes[0], 1, MPI_DOUBLE, 0, comm);
+        MPI_Gather(&idleTime, 1, MPI_DOUBLE, &rankIdleTimes[0], 1, MPI_DOUBLE, 0, comm);
+
+        if (procID == 0) {
+            long positionNodes = 0;
+            double maxReduceTime = 0;
+            double maxIdleTime = 0;
+            for (int i = 0; i < nproc; i ++) {
+                positionNodes += rankNodes[i];
+                maxReduceTime = std::max(maxReduceTime, rankReduceTimes[i]);
+                maxIdleTime = std::max(maxIdleTime, rankIdleTimes[i]);
+            }
+            totalTime += time;
+            totalNodes += positionNodes;
+
+            if (!first) {
+                std::cout << "," << std::endl;
+            }
+            first = false;
+            std::cout << "  {\"file\": \"" << files[f] << "\", \"bestMove\": \"" << board->algebraicNotation(best.first)
+                      << "\", \"score\": " << best.second << ", \"time\": " << time << ", \"nodes\": " << positionNodes
+                      << ", \"nps\": " << (long)(positionNodes / time) << ", \"reduceTime\": " << maxReduceTime
+                      << ", \"idleTime\": " << maxIdleTime << "," << std::endl;
+            std::cout << "   \"perRank\": [";
+            for (int i = 0; i < nproc; i ++) {
+                std::cout << (i > 0 ? ", " : "") << "{\"nodes\": " << rankNodes[i] << ", \"reduceTime\": " << rankReduceTimes[i]
+                          << ", \"idleTime\": " << rankIdleTimes[i] << "}";
+            }
+            std::cout << "]}";
+        }
+
+        board->freeCommunicators();
+        delete board;
+    }
+
+    if (procID == 0) {
+        std::cout << std::endl << " ]," << std::endl;
+        std::cout << " \"totalTime\": " << totalTime << ", \"totalNodes\": " << totalNodes
+                  << ", \"nps\": " << (long)(totalTime > 0 ? totalNodes / totalTime : 0) << "}" << std::endl;
+    }
+}
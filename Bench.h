@@ -0,0 +1,17 @@
+/**
+ * @file Bench.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include <vector>
+#include "Board.h"
+#include "LazySMP.h"
+#include "TranspositionTable.h"
+#include "mpi.h"
+
+// The depth searched when -b is given without -d.
+const int DEFAULT_BENCH_DEPTH = 5;
+
+void runBench(std::vector<char*>& files, int depth, bool dynamicScheduling, int numThreads, LazySMP* threads, TranspositionTable* table, Trace* trace, MPI_Comm comm);
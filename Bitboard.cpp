@@ -0,0 +1,223 @@
+/**
+ * @file Bitboard.cpp
+ * @author Greg Loose (gloose)
+ * @brief Attack generation for the bitboard board representation. Each
+ * bitboard is a 64-bit word with one bit per square (see squareIndex in
+ * Bitboard.h). Every attack is a table lookup:
+ * - The leaping pieces (pawns, knights and kings) attack the same squares
+ *   wherever the other pieces are, so their tables are built by the compiler
+ *   (see LEAPER_TABLES in Bitboard.h).
+ * - The sliding pieces depend on which squares along their rays are occupied.
+ *   Only the squares inside a piece's mask matter (the rays, less the last
+ *   square before the edge, which can never block anything), so for each
+ *   square there is a table with one entry per occupancy of its mask. With
+ *   BMI2, PEXT packs the masked occupancy into the index directly. Without
+ *   it, the index is found by multiplying by a "magic" number that happens to
+ *   hash every occupancy that matters to a distinct index (or to one with the
+ *   same attacks), and keeping the top bits. The magics are found by trial
+ *   and error at startup, which takes around 50 ms (filling the PEXT tables
+ *   takes about 2 ms).
+ *
+ * initBitboards must be called once before any Board is used. It chooses
+ * between PEXT and magics according to the CPU it runs on, since PEXT is an
+ * illegal instruction on CPUs without BMI2.
+ *
+ * @date 2022-05-04
+ */
+
+#include "Bitboard.h"
+#include <stdlib.h>
+#include <immintrin.h>
+
+// The number of entries in all the squares' tables together: the sum over
+// squares of 2 to the power of the number of squares in the mask.
+const int ROOK_TABLE_SIZE = 0x19000;
+const int BISHOP_TABLE_SIZE = 0x1480;
+
+SliderEntry rookEntries[NUM_SQUARES];
+SliderEntry bishopEntries[NUM_SQUARES];
+bool usePext = false;
+
+static Bitboard rookTable[ROOK_TABLE_SIZE];
+static Bitboard bishopTable[BISHOP_TABLE_SIZE];
+static Bitboard betweenTable[NUM_SQUARES][NUM_SQUARES];
+static Bitboard lineTable[NUM_SQUARES][NUM_SQUARES];
+
+static const int ROOK_DIRS[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+static const int BISHOP_DIRS[4][2] = { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+
+/**
+ * Attacks along the given rays, found by walking each one. This is only used
+ * to fill in the tables.
+ */
+static Bitboard slidingAttacks(int sq, Bitboard occupied, const int dirs[4][2]) {
+    Bitboard attacks = 0;
+    int r = squareRow(sq);
+    int c = squareCol(sq);
+    for (int d = 0; d < 4; d ++) {
+        int dy = dirs[d][0];
+        int dx = dirs[d][1];
+        for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
+            Bitboard bit = squareBB(squareIndex(r + i * dy, c + i * dx));
+            attacks |= bit;
+            if (occupied & bit) {
+                break;
+            }
+        }
+    }
+    return attacks;
+}
+
+__attribute__((target("bmi2")))
+static uint64_t pextIndex(Bitboard occupied, Bitboard mask) {
+    return _pext_u64(occupied, mask);
+}
+
+__attribute__((target("bmi2")))
+Bitboard pextAttacks(const SliderEntry& entry, Bitboard occupied) {
+    return entry.attacks[_pext_u64(occupied, entry.mask)];
+}
+
+// The random numbers tried as magics are seeded the same way every time, so
+// that every process finds the same magics in the same time. These seeds,
+// one per row, are ones Stockfish found to give magics quickly.
+static const uint64_t MAGIC_SEEDS[HEIGHT] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+
+/**
+ * An xorshift generator.
+ */
+static uint64_t nextRandom(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+/**
+ * Fills in one kind of slider's entries, and its attack table. table is
+ * shared between the squares, each getting as many entries as its mask has
+ * occupancies.
+ */
+static void initSliders(SliderEntry entries[], Bitboard table[], const int dirs[4][2]) {
+    static Bitboard occupancies[4096];
+    static Bitboard reference[4096];
+    // epoch[i] is the last attempt that used entry i, so that the entries
+    // don't need to be cleared between attempts.
+    static int epoch[4096] = {};
+    static int attempt = 0;
+    Bitboard* next = table;
+
+    for (int sq = 0; sq < NUM_SQUARES; sq ++) {
+        // The edges only matter along the edge the piece is on.
+        Bitboard edges = ((RANK_1 | RANK_8) & ~(RANK_1 << (WIDTH * (squareRow(sq) - 1))))
+            | ((FILE_A | FILE_H) & ~(FILE_A << (squareCol(sq) - 1)));
+
+        SliderEntry& entry = entries[sq];
+        entry.mask = slidingAttacks(sq, 0, dirs) & ~edges;
+        entry.shift = 64 - popCount(entry.mask);
+        entry.attacks = next;
+
+        // Enumerate every subset of the mask (the Carry-Rippler trick).
+        int size = 0;
+        Bitboard b = 0;
+        do {
+            occupancies[size] = b;
+            reference[size] = slidingAttacks(sq, b, dirs);
+            if (usePext) {
+                entry.attacks[pextIndex(b, entry.mask)] = reference[size];
+            }
+            size ++;
+            b = (b - entry.mask) & entry.mask;
+        } while (b);
+        next += size;
+
+        if (usePext) {
+            continue;
+        }
+
+        // Try sparse random numbers until one sends every occupancy to an
+        // entry that is either unused so far (in this attempt) or already
+        // holds the same attacks.
+        uint64_t seed = MAGIC_SEEDS[squareRow(sq) - 1];
+        while (true) {
+            do {
+                entry.magic = nextRandom(seed) & nextRandom(seed) & nextRandom(seed);
+            } while (popCount((entry.mask * entry.magic) >> 56) < 6);
+
+            attempt ++;
+            int i;
+            for (i = 0; i < size; i ++) {
+                int index = (int)((occupancies[i] * entry.magic) >> entry.shift);
+                if (epoch[index] < attempt) {
+                    epoch[index] = attempt;
+                    entry.attacks[index] = reference[i];
+                } else if (entry.attacks[index] != reference[i]) {
+                    break;
+                }
+            }
+            if (i == size) {
+                break;
+            }
+        }
+    }
+}
+
+void initBitboards() {
+    __builtin_cpu_init();
+    usePext = __builtin_cpu_supports("bmi2");
+    initSliders(rookEntries, rookTable, ROOK_DIRS);
+    initSliders(bishopEntries, bishopTable, BISHOP_DIRS);
+
+    for (int sq1 = 0; sq1 < NUM_SQUARES; sq1 ++) {
+        for (int sq2 = 0; sq2 < NUM_SQUARES; sq2 ++) {
+            betweenTable[sq1][sq2] = 0;
+            lineTable[sq1][sq2] = 0;
+        }
+    }
+
+    // Walk all 8 rays from each square. Every square passed on the way to
+    // sq2 is between sq1 and sq2, and the line through both is the full ray
+    // in both directions.
+    for (int sq1 = 0; sq1 < NUM_SQUARES; sq1 ++) {
+        int r = squareRow(sq1);
+        int c = squareCol(sq1);
+        for (int dy = -1; dy <= 1; dy ++) {
+            for (int dx = -1; dx <= 1; dx ++) {
+                if (dx == 0 && dy == 0) {
+                    continue;
+                }
+                Bitboard line = squareBB(sq1);
+                for (int i = 1; Position(r + i * dy, c + i * dx).isValid(); i ++) {
+                    line |= squareBB(squareIndex(r + i * dy, c + i * dx));
+                }
+                for (int i = 1; Position(r - i * dy, c - i * dx).isValid(); i ++) {
+                    line |= squareBB(squareIndex(r - i * dy, c - i * dx));
+                }
+
+                Bitboard between = 0;
+                for (int i = 1; Position(r + i * dy, c + i * dx).isValid(); i ++) {
+                    int sq2 = squareIndex(r + i * dy, c + i * dx);
+                    betweenTable[sq1][sq2] = between;
+                    lineTable[sq1][sq2] = line;
+                    between |= squareBB(sq2);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Squares strictly between two squares on the same rank, file or diagonal.
+ * Empty if the squares are not aligned.
+ */
+Bitboard betweenBB(int sq1, int sq2) {
+    return betweenTable[sq1][sq2];
+}
+
+/**
+ * The whole rank, file or diagonal through two squares, edge to edge.
+ * Empty if the squares are not aligned.
+ */
+Bitboard lineBB(int sq1, int sq2) {
+    return lineTable[sq1][sq2];
+}
@@ -0,0 +1,167 @@
+/**
+ * @file Bitboard.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include <stdint.h>
+#include "Piece.h"
+#include "Position.h"
+
+typedef uint64_t Bitboard;
+
+const int NUM_SQUARES = WIDTH * HEIGHT;
+
+const Bitboard FILE_A = 0x0101010101010101ULL;
+const Bitboard FILE_H = 0x8080808080808080ULL;
+const Bitboard RANK_1 = 0x00000000000000FFULL;
+const Bitboard RANK_2 = 0x000000000000FF00ULL;
+const Bitboard RANK_4 = 0x00000000FF000000ULL;
+const Bitboard RANK_5 = 0x000000FF00000000ULL;
+const Bitboard RANK_7 = 0x00FF000000000000ULL;
+const Bitboard RANK_8 = 0xFF00000000000000ULL;
+
+/**
+ * Squares are numbered 0-63 starting from a1, so that a square's bit index
+ * is (row - 1) * WIDTH + (col - 1) in the 1-based coordinates used by Board.
+ */
+inline int squareIndex(int row, int col) {
+    return (row - 1) * WIDTH + (col - 1);
+}
+
+inline int squareRow(int sq) {
+    return sq / WIDTH + 1;
+}
+
+inline int squareCol(int sq) {
+    return sq % WIDTH + 1;
+}
+
+inline Bitboard squareBB(int sq) {
+    return 1ULL << sq;
+}
+
+/**
+ * Returns the bit for (row, col), or an empty bitboard if it is off the board.
+ */
+inline Bitboard bitIfValid(int row, int col) {
+    if (!Position(row, col).isValid()) {
+        return 0;
+    }
+    return squareBB(squareIndex(row, col));
+}
+
+inline int popCount(Bitboard b) {
+    return __builtin_popcountll(b);
+}
+
+inline int lsb(Bitboard b) {
+    return __builtin_ctzll(b);
+}
+
+inline int popLsb(Bitboard& b) {
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+/**
+ * The square dr rows and dc columns away from sq, as a bitboard, or an empty
+ * bitboard if that is off the board.
+ */
+constexpr Bitboard stepBB(int sq, int dr, int dc) {
+    return (sq / WIDTH + dr >= 0 && sq / WIDTH + dr < HEIGHT && sq % WIDTH + dc >= 0 && sq % WIDTH + dc < WIDTH)
+        ? 1ULL << (sq + dr * WIDTH + dc) : 0;
+}
+
+/**
+ * Attacks of the leaping pieces, which don't depend on the other pieces on
+ * the board. pawn[color][sq] is the two forward diagonals of a pawn of that
+ * color, which are not necessarily squares it can move to.
+ */
+struct LeaperTables {
+    Bitboard pawn[3][NUM_SQUARES];
+    Bitboard knight[NUM_SQUARES];
+    Bitboard king[NUM_SQUARES];
+};
+
+constexpr LeaperTables makeLeaperTables() {
+    LeaperTables tables = {};
+    for (int sq = 0; sq < NUM_SQUARES; sq ++) {
+        tables.pawn[WHITE][sq] = stepBB(sq, 1, -1) | stepBB(sq, 1, 1);
+        tables.pawn[BLACK][sq] = stepBB(sq, -1, -1) | stepBB(sq, -1, 1);
+        for (int dr = -2; dr <= 2; dr ++) {
+            for (int dc = -2; dc <= 2; dc ++) {
+                if (dr * dr + dc * dc == 5) {
+                    tables.knight[sq] |= stepBB(sq, dr, dc);
+                }
+                if ((dr != 0 || dc != 0) && dr * dr <= 1 && dc * dc <= 1) {
+                    tables.king[sq] |= stepBB(sq, dr, dc);
+                }
+            }
+        }
+    }
+    return tables;
+}
+
+// Built by the compiler, so they are ready before initBitboards is called.
+constexpr LeaperTables LEAPER_TABLES = makeLeaperTables();
+
+inline Bitboard pawnAttacks(Color color, int sq) {
+    return LEAPER_TABLES.pawn[color][sq];
+}
+
+inline Bitboard knightAttacks(int sq) {
+    return LEAPER_TABLES.knight[sq];
+}
+
+inline Bitboard kingAttacks(int sq) {
+    return LEAPER_TABLES.king[sq];
+}
+
+/**
+ * What a slider on one square needs to look up its attacks (see
+ * Bitboard.cpp): the squares whose occupancy matters, and either a magic
+ * number and shift that hash them into an index, or nothing more with PEXT.
+ */
+struct SliderEntry {
+    Bitboard mask;
+    Bitboard magic;
+    Bitboard* attacks;
+    int shift;
+};
+
+extern SliderEntry rookEntries[NUM_SQUARES];
+extern SliderEntry bishopEntries[NUM_SQUARES];
+extern bool usePext;
+
+Bitboard pextAttacks(const SliderEntry& entry, Bitboard occupied);
+
+inline Bitboard sliderAttacks(const SliderEntry& entry, Bitboard occupied) {
+    if (usePext) {
+        return pextAttacks(entry, occupied);
+    }
+    return entry.attacks[((occupied & entry.mask) * entry.magic) >> entry.shift];
+}
+
+/**
+ * Attacks of a sliding piece on sq, given the occupied squares. The first
+ * occupied square on each ray is included, since it may hold an enemy piece
+ * that can be captured.
+ */
+inline Bitboard rookAttacks(int sq, Bitboard occupied) {
+    return sliderAttacks(rookEntries[sq], occupied);
+}
+
+inline Bitboard bishopAttacks(int sq, Bitboard occupied) {
+    return sliderAttacks(bishopEntries[sq], occupied);
+}
+
+inline Bitboard queenAttacks(int sq, Bitboard occupied) {
+    return rookAttacks(sq, occupied) | bishopAttacks(sq, occupied);
+}
+
+void initBitboards();
+Bitboard betweenBB(int sq1, int sq2);
+Bitboard lineBB(int sq1, int sq2);
@@ -4,11 +4,25 @@
  * @brief This file contains the main code for my final project.
  * It can be run as follows:
  * 
- * mpirun -np X -f Y -d Z
+ * mpirun -np X -f Y -d Z [-t T] [-m M] [-w] [-j J] [-s] [-T F] [-p P]
+ * mpirun -np X -b [-d Z] [-m M] [-w] [-j J] [-T F] FILES...
  * 
  * Where X is an integer number of cores, Y is a file name, and Z is a
  * positive integer. If X is omitted, the default board state with all pieces
- * in their initial positions will be used.
+ * in their initial positions will be used. If T is given, each move is
+ * searched with iterative deepening for up to T milliseconds instead of to a
+ * fixed depth, and Z (if given) is the maximum depth. M is the size in megabytes of the
+ * transposition table shared by all processes on each machine (default 64, or
+ * 0 to disable it). With -w, subtrees are handed out to processes dynamically
+ * as they become idle (see Scheduler.cpp), instead of being split evenly. J is
+ * the number of threads searching in each process (see LazySMP.cpp). With
+ * -s, statistics about each search are printed (see SearchStats.cpp). With
+ * -T, a timeline of what each process did is written to the file F at the
+ * end of the run (see Trace.cpp). With
+ * -p, instead of playing, the program counts the positions P moves deep from
+ * the starting position (perft), to test and time move generation. The
+ * second form benchmarks the search on each of the given files (see
+ * Bench.cpp).
  * 
  * The input file, if provided, should have a W or B on its first line to
  * indicate which player is to move. The following 8 lines should each be
@@ -29,6 +43,9 @@
 #include <vector>
 #include <iostream>
 #include "Board.h"
+#include "Scheduler.h"
+#include "LazySMP.h"
+#include "Bench.h"
 #include <stdlib.h>
 #include <sstream>
 #include <limits>
@@ -37,30 +54,39 @@
 #include <unistd.h>
 #include <algorithm>
 #include <math.h>
+#include <chrono>
 
 #define infty std::numeric_limits<double>::infinity()
 
 Board::Board() {
-    board.resize(WIDTH * HEIGHT);
-    numCalls = new long[1];
-    *numCalls = 0;
-    reduceTime = new double[1];
-    *reduceTime = 0;
+    for (int c = 0; c < 3; c ++) {
+        for (int t = 0; t < 7; t ++) {
+            pieceBB[c][t] = 0;
+        }
+        occupancy[c] = 0;
+    }
+    for (int i = 0; i < MAILBOX_SIZE; i ++) {
+        mailbox[i] = Piece(true);
+    }
+    for (int row = 1; row <= HEIGHT; row ++) {
+        for (int col = 1; col <= WIDTH; col ++) {
+            mailbox[mailboxIndex(row, col)] = Piece();
+        }
+    }
+    undoStack.reserve(MAX_UNDO_DEPTH);
 }
 
 /**
  * Note: when referring to positions on the board, rows and columns start
  * at 1, not 0. This is intended to map the logic more closely to the usual
  * chess notation (though to be honest it has tripped me up many times). 
+ *
+ * A square just off the board (row 0 or 9, or column 0 or 9, or up to two
+ * rows beyond) holds an invalid piece, so no bounds check is needed. The
+ * caller must not go any further than that.
  */
 Piece Board::getPiece(int row, int col) {
-    row--;
-    col--;
-    if (row < 0 || row >= HEIGHT || col < 0 || col >= WIDTH) {
-        Piece piece(true);
-        return piece;
-    }
-    return board[row * WIDTH + col];
+    return mailbox[mailboxIndex(row, col)];
 }
 
 Piece Board::getPiece(Position pos) {
@@ -68,15 +94,38 @@ Piece Board::getPiece(Position pos) {
 }
 
 void Board::setPiece(int row, int col, Piece piece) {
-    row--;
-    col--;
-    board[row * WIDTH + col] = piece;
-    board[row * WIDTH + col].setPos(row + 1, col + 1);
+    int sq = squareIndex(row, col);
+    Bitboard bit = squareBB(sq);
+    Piece& square = mailbox[mailboxIndex(row, col)];
+
+    Color oldColor = square.getColor();
+    PieceType oldType = square.getType();
+    if (oldType != NONE) {
+        hashKey ^= zobristPieces[oldColor][oldType][sq];
+        midgameScore -= pieceSquareMidgame[oldColor][oldType][sq];
+        endgameScore -= pieceSquareEndgame[oldColor][oldType][sq];
+        phase -= phaseWeights[oldType];
+        pieceBB[oldColor][oldType] &= ~bit;
+        occupancy[oldColor] &= ~bit;
+        occupancy[NOCOLOR] &= ~bit;
+    }
+    hashKey ^= zobristPieces[piece.getColor()][piece.getType()][sq];
+    midgameScore += pieceSquareMidgame[piece.getColor()][piece.getType()][sq];
+    endgameScore += pieceSquareEndgame[piece.getColor()][piece.getType()][sq];
+    phase += phaseWeights[piece.getType()];
+    square = piece;
+
+    if (piece.getType() != NONE) {
+        pieceBB[piece.getColor()][piece.getType()] |= bit;
+        occupancy[piece.getColor()] |= bit;
+        occupancy[NOCOLOR] |= bit;
+    }
+
     if (piece.getType() == KING) {
         if (piece.getColor() == WHITE) {
-            whiteKingPos = Position(row + 1, col + 1);
+            whiteKingPos = Position(row, col);
         } else {
-            blackKingPos = Position(row + 1, col + 1);
+            blackKingPos = Position(row, col);
         }
     }
 }
@@ -114,10 +163,131 @@ void Board::initializeBoard() {
         setPiece(7, i, Piece(BLACK, PAWN));
     }
 
+    hashKey ^= castlingAndEnPassantKey();
     whiteCanCastleLeft = true;
     blackCanCastleLeft = true;
     whiteCanCastleRight = true;
     blackCanCastleRight = true;
+    hashKey ^= castlingAndEnPassantKey();
+}
+
+/**
+ * Loads a position from a file (see the top of this file for the format),
+ * replacing whatever is on the board, and sets toMove to the player to move.
+ * Collective over comm, since every process reads the file. Returns false if
+ * the file doesn't say who is to move.
+ */
+bool Board::readFile(const char* filename, Color& toMove, MPI_Comm comm) {
+    MPI_File input;
+    MPI_File_open(comm, filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &input);
+
+    char line[WIDTH + 1];
+    MPI_File_read(input, line, 2, MPI_CHAR, MPI_STATUS_IGNORE);
+
+    if (line[0] == 'W' || line[0] == 'w') {
+        toMove = WHITE;
+    } else if (line[0] == 'B' || line[0] == 'b') {
+        toMove = BLACK;
+    } else {
+        MPI_File_close(&input);
+        return false;
+    }
+
+    for (int i = HEIGHT; i >= 1; i --) {
+        MPI_File_read(input, line, WIDTH + 1, MPI_CHAR, MPI_STATUS_IGNORE);
+        for (int j = 1; j <= WIDTH; j ++) {
+            Piece piece;
+            switch (line[j - 1]) {
+                case 'P':
+                    piece = Piece(WHITE, PAWN);
+                    break;
+                case 'p':
+                    piece = Piece(BLACK, PAWN);
+                    break;
+                case 'R':
+                    piece = Piece(WHITE, ROOK);
+                    break;
+                case 'r':
+                    piece = Piece(BLACK, ROOK);
+                    break;
+                case 'N':
+                    piece = Piece(WHITE, KNIGHT);
+                    break;
+                case 'n':
+                    piece = Piece(BLACK, KNIGHT);
+                    break;
+                case 'B':
+                    piece = Piece(WHITE, BISHOP);
+                    break;
+                case 'b':
+                    piece = Piece(BLACK, BISHOP);
+                    break;
+                case 'Q':
+                    piece = Piece(WHITE, QUEEN);
+                    break;
+                case 'q':
+                    piece = Piece(BLACK, QUEEN);
+                    break;
+                case 'K':
+                    piece = Piece(WHITE, KING);
+                    break;
+                case 'k':
+                    piece = Piece(BLACK, KING);
+                    break;
+                case ' ':
+                    piece = Piece(NOCOLOR, NONE);
+                    break;
+            }
+            setPiece(i, j, piece);
+        }
+    }
+
+    MPI_File_close(&input);
+
+    whiteCanEnPassant = 0;
+    blackCanEnPassant = 0;
+    whiteCanCastleLeft = false;
+    blackCanCastleLeft = false;
+    whiteCanCastleRight = false;
+    blackCanCastleRight = false;
+    undoStack.clear();
+    return true;
+}
+
+/**
+ * The part of the Zobrist hash that covers castling rights and en passant.
+ * The hash of the pieces is kept up to date by setPiece; whenever the flags
+ * change, this is XORed out before and back in after.
+ */
+uint64_t Board::castlingAndEnPassantKey() {
+    uint64_t key = zobristEnPassant[WHITE][whiteCanEnPassant] ^ zobristEnPassant[BLACK][blackCanEnPassant];
+    if (whiteCanCastleLeft) {
+        key ^= zobristCastling[0];
+    }
+    if (whiteCanCastleRight) {
+        key ^= zobristCastling[1];
+    }
+    if (blackCanCastleLeft) {
+        key ^= zobristCastling[2];
+    }
+    if (blackCanCastleRight) {
+        key ^= zobristCastling[3];
+    }
+    return key;
+}
+
+/**
+ * The Zobrist hash of the current position with the given player to move.
+ */
+uint64_t Board::getHashKey(Color toMove) {
+    if (toMove == BLACK) {
+        return hashKey ^ zobristBlackToMove;
+    }
+    return hashKey;
+}
+
+void Board::setTranspositionTable(TranspositionTable* tt) {
+    table = tt;
 }
 
 void Board::printBoard() {
@@ -154,140 +324,79 @@ void Board::printBoard() {
     std::cout << output.str() << std::endl;
 }
 
-Move Board::makeMove(Piece piece, int row, int col) {
-    return Move(piece.getRow(), piece.getCol(), row, col);
-}
-
 bool Board::findCheck(Color toMove) {
-    int r = 0;
-    int c = 0;
-    
-    if (toMove == WHITE) {
-        if (!whiteKingPos.isValid()) {
-            return false;
-        }
-        r = whiteKingPos.row;
-        c = whiteKingPos.col;
-    } else {
-        if (!blackKingPos.isValid()) {
-            return false;
-        }
-        r = blackKingPos.row;
-        c = blackKingPos.col;
-    }
-
-    // Find pawn check
-    Piece leftDiag = Piece();
-    Piece rightDiag = Piece();
+    Position kingPos;
     if (toMove == WHITE) {
-        leftDiag = getPiece(r + 1, c - 1);
-        rightDiag = getPiece(r + 1, c + 1);
+        kingPos = whiteKingPos;
     } else {
-        leftDiag = getPiece(r - 1, c - 1);
-        rightDiag = getPiece(r - 1, c + 1);
-    }
-    if ((leftDiag.getColor() != toMove && leftDiag.getType() == PAWN) || (rightDiag.getColor() != toMove && rightDiag.getType() == PAWN)) {
-        return true;
-    }
-
-    // Find knight check
-    for (int i = -2; i <= 2; i ++) {
-        for (int j = -2; j <= 2; j ++) {
-            if (abs(i) + abs(j) == 3) {
-                Piece p = getPiece(r + i, c + j);
-                if (!p.isInvalid() && p.getColor() != toMove && p.getType() == KNIGHT) {
-                    return true;
-                }
-            }
-        }
-    }
-
-    // Find rook check
-    for (int dy = -1; dy <= 1; dy ++) {
-        for (int dx = -1; dx <= 1; dx ++) {
-            if ((dx == 0) != (dy == 0)) {
-                for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
-                    Piece p = getPiece(r + i * dy, c + i * dx);
-                    if (p.getColor() != toMove && (p.getType() == ROOK || p.getType() == QUEEN)) {
-                        return true;
-                    }
-                    if (p.getType() != NONE) {
-                        break;
-                    }
-                }
-            }
-        }
+        kingPos = blackKingPos;
     }
 
-    // Find bishop check
-    for (int dx = -1; dx <= 1; dx += 2) {
-        for (int dy = -1; dy <= 1; dy += 2) {
-            for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
-                Piece p = getPiece(r + i * dy, c + i * dx);
-                if (p.getColor() != toMove && (p.getType() == BISHOP || p.getType() == QUEEN)) {
-                    return true;
-                }
-                if (p.getType() != NONE) {
-                    break;
-                }
-            }
-        }
+    if (!kingPos.isValid()) {
+        return false;
     }
 
-    // Find king check
-    for (int i = r - 1; i <= r + 1; i ++) {
-        for (int j = c - 1; j <= c + 1; j ++) {
-            Piece p = getPiece(i, j);
-            if (!p.isInvalid() && p.getColor() != toMove && p.getType() == KING) {
-                return true;
-            }
-        }
-    }
+    Color other = (toMove == WHITE) ? BLACK : WHITE;
+    return isAttacked(squareIndex(kingPos.row, kingPos.col), other);
+}
 
-    return false;
+/**
+ * Is the square attacked by any piece of the given color? Rather than
+ * searching outwards from every attacker, this works backwards from the
+ * square: e.g. a knight on the square would attack exactly the squares from
+ * which an enemy knight attacks it.
+ */
+bool Board::isAttacked(int sq, Color attacker) {
+    Color defender = (attacker == WHITE) ? BLACK : WHITE;
+    Bitboard occupied = occupancy[NOCOLOR];
+    Bitboard queens = pieceBB[attacker][QUEEN];
+
+    return (pawnAttacks(defender, sq) & pieceBB[attacker][PAWN])
+        || (knightAttacks(sq) & pieceBB[attacker][KNIGHT])
+        || (kingAttacks(sq) & pieceBB[attacker][KING])
+        || (rookAttacks(sq, occupied) & (pieceBB[attacker][ROOK] | queens))
+        || (bishopAttacks(sq, occupied) & (pieceBB[attacker][BISHOP] | queens));
 }
 
 bool Board::isValidMove(Move move) {
-    if (move.row1 < 1 || move.row1 > HEIGHT || move.col1 < 1 || move.col1 > WIDTH || move.row2 < 1 || move.row2 > HEIGHT || move.col2 < 1 || move.col2 > WIDTH) {
+    if (move.isNull()) {
         return false;
     }
-    Color toMove = getPiece(move.row1, move.col1).getColor();
-    Board prevState = *this;
+    Color toMove = getPiece(move.fromRow(), move.fromCol()).getColor();
     Piece taken = applyMove(move);
     bool check = findCheck(toMove);
-    *this = prevState;
+    undoMove(move, taken);
     return !check;
 }
 
-void Board::addMove(Move move, std::vector< std::pair<double, Move> >& moves) {
-    if (isValidMove(move)) {
-        moves.push_back(std::pair<double, Move>(0, move));
-    }
-}
-
 /**
- * An alternative comparison for move sorting for alpha-beta pruning.
- * This sort was suggested by the Cornell University site (see references in
- * report), but ultimately provided worse performance.
+ * getAllMoves only generates legal moves, so no check is needed here.
+ * isValidMove is still available for moves that come from elsewhere.
  */
-bool comparePairs(std::pair<double, Move> a, std::pair<double, Move> b) {
-    return fabs(a.first) < fabs(b.first);
+void Board::addMove(Move move, MoveList& moves) {
+    moves.add(move);
 }
 
 /**
- * Sorts (score, move) pairs by decreasing score.
+ * Adds a pawn move, which on the last row becomes one move per piece the pawn
+ * can promote to. The quiescence search only looks at queen promotions.
  */
-bool comparePairsWhite(std::pair<double, Move> a, std::pair<double, Move> b) {
-    return a.first > b.first;
-}
+void Board::addPawnMove(int from, int to, int flags, bool capturesOnly, MoveList& moves) {
+    int row = squareRow(to);
+    if (row != 1 && row != HEIGHT) {
+        addMove(Move(from, to, flags), moves);
+        return;
+    }
 
-/**
- * Sorts (score, move) pairs by increasing score.
- */
-bool comparePairsBlack(std::pair<double, Move> a, std::pair<double, Move> b) {
-    return a.first < b.first;
+    addMove(Move(from, to, flags | PROMOTION | (QUEEN - ROOK)), moves);
+    if (!capturesOnly) {
+        addMove(Move(from, to, flags | PROMOTION | (KNIGHT - ROOK)), moves);
+        addMove(Move(from, to, flags | PROMOTION | (ROOK - ROOK)), moves);
+        addMove(Move(from, to, flags | PROMOTION | (BISHOP - ROOK)), moves);
+    }
 }
 
+
 /**
  * Can the piece at this position be taken en passant?
  */
@@ -314,26 +423,24 @@ bool Board::enPassant(int row, int col, Color toMove) {
 }
 
 bool Board::canCastleLeft(Color toMove) {
-    Piece king;
+    Position king;
     if (toMove == WHITE) {
         if (!whiteCanCastleLeft) {
             return false;
         }
-        king = getPiece(whiteKingPos);
+        king = whiteKingPos;
     } else {
         if (!blackCanCastleLeft) {
             return false;
         }
-        king = getPiece(blackKingPos);
+        king = blackKingPos;
     }
 
-    int kingRow = king.getRow();
-    int kingCol = king.getCol();
+    int kingRow = king.row;
+    int kingCol = king.col;
 
-    Piece rook = getPiece(kingRow, 1);
-
-    for (int i = kingCol - 1; i > rook.getCol(); i --) {
-        if (getPiece(kingRow, i).getType() != NONE) {
+    for (int i = kingCol - 1; i > 1; i --) {
+        if (occupancy[NOCOLOR] & squareBB(squareIndex(kingRow, i))) {
             return false;
         }
     }
@@ -363,26 +470,24 @@ bool Board::canCastleLeft(Color toMove) {
 }
 
 bool Board::canCastleRight(Color toMove) {
-    Piece king;
+    Position king;
     if (toMove == WHITE) {
         if (!whiteCanCastleRight) {
             return false;
         }
-        king = getPiece(whiteKingPos);
+        king = whiteKingPos;
     } else {
         if (!blackCanCastleRight) {
             return false;
         }
-        king = getPiece(blackKingPos);
+        king = blackKingPos;
     }
 
-    int kingRow = king.getRow();
-    int kingCol = king.getCol();
-
-    Piece rook = getPiece(kingRow, 8);
+    int kingRow = king.row;
+    int kingCol = king.col;
 
-    for (int i = kingCol + 1; i < rook.getCol(); i ++) {
-        if (getPiece(kingRow, i).getType() != NONE) {
+    for (int i = kingCol + 1; i < WIDTH; i ++) {
+        if (occupancy[NOCOLOR] & squareBB(squareIndex(kingRow, i))) {
             return false;
         }
     }
@@ -411,338 +516,268 @@ bool Board::canCastleRight(Color toMove) {
     return true;
 }
 
-void Board::getAllMoves(Color toMove, std::vector< std::pair<double, Move> >& moves) {
-    for (int r = 1; r <= HEIGHT; r ++) {
-        for (int c = 1; c <= WIDTH; c ++) {
-            Piece piece = getPiece(r, c);
-            PieceType type = piece.getType();
-            Color color = piece.getColor();
-            
-            if (color != toMove) {
-                continue;
+/**
+ * Generates the legal moves for every piece of one color. Rather than trying
+ * out each candidate move and looking for check afterwards, the pieces giving
+ * check and the pieces pinned to the king are found once up front:
+ * - In double check, only the king can move.
+ * - In single check, any other piece must capture the checker or block the
+ *   line between it and the king (the evasion mask).
+ * - A pinned piece can only move along the line through it and its king.
+ * - The king can only move to squares that are not attacked once it has left
+ *   its current square.
+ * En passant is the one move that removes two pieces from a line at once, so
+ * it is checked against the exact occupancy after the capture instead.
+ *
+ * With capturesOnly, only captures (including en passant) are generated, for
+ * the quiescence search.
+ */
+void Board::getAllMoves(Color toMove, MoveList& moves, bool capturesOnly) {
+    Color other = (toMove == WHITE) ? BLACK : WHITE;
+    Bitboard own = occupancy[toMove];
+    Bitboard enemy = occupancy[other];
+    Bitboard occupied = occupancy[NOCOLOR];
+    Bitboard empty = ~occupied;
+    int forward = (toMove == WHITE) ? 1 : -1;
+    Bitboard startRank = (toMove == WHITE) ? RANK_2 : RANK_7;
+    Bitboard targetMask = capturesOnly ? enemy : ~0ULL;
+
+    Bitboard kingBB = pieceBB[toMove][KING];
+    int kingSq = -1;
+    Bitboard checkers = 0;
+    Bitboard pinned = 0;
+    Bitboard evasionMask = ~0ULL;
+    if (kingBB) {
+        kingSq = lsb(kingBB);
+        checkers = attackersTo(kingSq, occupied) & enemy;
+        pinned = pinnedPieces(toMove, kingSq);
+        if (checkers) {
+            evasionMask = checkers | betweenBB(kingSq, lsb(checkers));
+        }
+    }
+
+    if (popCount(checkers) < 2) {
+        Bitboard pawns = pieceBB[toMove][PAWN];
+        while (pawns) {
+            int sq = popLsb(pawns);
+            int r = squareRow(sq);
+            int c = squareCol(sq);
+
+            Bitboard allowed = evasionMask;
+            if (pinned & squareBB(sq)) {
+                allowed &= lineBB(kingSq, sq);
             }
 
-            switch (type) {
-                case NONE:
-                    break;
-                case PAWN:
-                    if (color == WHITE) {
-                        if (r < HEIGHT && getPiece(r + 1, c).getType() == NONE) {
-                            addMove(makeMove(piece, r + 1, c), moves);
-                        }
-                        if (r == 2 && getPiece(r + 1, c).getType() == NONE && getPiece(r + 2, c).getType() == NONE) {
-                            addMove(makeMove(piece, r + 2, c), moves);
-                        }
-                        
-                        Piece diagLeft = getPiece(r + 1, c - 1);
-                        Piece diagRight = getPiece(r + 1, c + 1);
-                        if (!diagLeft.isInvalid() && diagLeft.getColor() == BLACK) {
-                            addMove(makeMove(piece, r + 1, c - 1), moves);
-                        }
-                        if (!diagRight.isInvalid() && diagRight.getColor() == BLACK) {
-                            addMove(makeMove(piece, r + 1, c + 1), moves);
-                        }
-                        
-                        if (enPassant(r, c - 1, WHITE)) {
-                            addMove(makeMove(piece, r + 1, c - 1), moves);
-                        }
-                        if (enPassant(r, c + 1, WHITE)) {
-                            addMove(makeMove(piece, r + 1, c + 1), moves);
-                        }
-                    } else {
-                        if (r > 1 && getPiece(r - 1, c).getType() == NONE) {
-                            addMove(makeMove(piece, r - 1, c), moves);
-                        }
-                        if (r == 7 && getPiece(r - 1, c).getType() == NONE && getPiece(r - 2, c).getType() == NONE) {
-                            addMove(makeMove(piece, r - 2, c), moves);
-                        }
-                        
-                        Piece diagLeft = getPiece(r - 1, c - 1);
-                        Piece diagRight = getPiece(r - 1, c + 1);
-                        if (!diagLeft.isInvalid() && diagLeft.getColor() == WHITE) {
-                            addMove(makeMove(piece, r - 1, c - 1), moves);
-                        }
-                        if (!diagRight.isInvalid() && diagRight.getColor() == WHITE) {
-                            addMove(makeMove(piece, r - 1, c + 1), moves);
-                        }
-
-                        if (enPassant(r, c - 1, BLACK)) {
-                            addMove(makeMove(piece, r - 1, c - 1), moves);
-                        }
-                        if (enPassant(r, c + 1, BLACK)) {
-                            addMove(makeMove(piece, r - 1, c + 1), moves);
-                        }
-                    }
-                    break;
-                case ROOK:
-                    for (int dy = -1; dy <= 1; dy ++) {
-                        for (int dx = -1; dx <= 1; dx ++) {
-                            if ((dx == 0) != (dy == 0)) {
-                                for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
-                                    Piece p = getPiece(r + i * dy, c + i * dx);
-                                    if (p.getColor() != color) {
-                                        addMove(makeMove(piece, r + i * dy, c + i * dx), moves);
-                                    }
-                                    if (p.getType() != NONE) {
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    break;
-                case KNIGHT:
-                    for (int i = -2; i <= 2; i ++) {
-                        for (int j = -2; j <= 2; j ++) {
-                            if (abs(i) + abs(j) == 3) {
-                                Piece p = getPiece(r + i, c + j);
-                                if (!p.isInvalid() && p.getColor() != color) {
-                                    addMove(makeMove(piece, r + i, c + j), moves);
-                                }
-                            }
-                        }
-                    }
-                    break;
-                case BISHOP:
-                    for (int dx = -1; dx <= 1; dx += 2) {
-                        for (int dy = -1; dy <= 1; dy += 2) {
-                            for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
-                                Piece p = getPiece(r + i * dy, c + i * dx);
-                                if (p.getColor() != color) {
-                                    addMove(makeMove(piece, r + i * dy, c + i * dx), moves);
-                                }
-                                if (p.getType() != NONE) {
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                    break;
-                case QUEEN:
-                    for (int dy = -1; dy <= 1; dy ++) {
-                        for (int dx = -1; dx <= 1; dx ++) {
-                            if ((dx == 0) != (dy == 0)) {
-                                for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
-                                    Piece p = getPiece(r + i * dy, c + i * dx);
-                                    if (p.getColor() != color) {
-                                        addMove(makeMove(piece, r + i * dy, c + i * dx), moves);
-                                    }
-                                    if (p.getType() != NONE) {
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-                    }
+            Bitboard push = bitIfValid(r + forward, c);
+            if ((push & empty) && !capturesOnly) {
+                if (push & allowed) {
+                    addPawnMove(sq, lsb(push), QUIET, capturesOnly, moves);
+                }
+                Bitboard doublePush = bitIfValid(r + 2 * forward, c);
+                if ((startRank & squareBB(sq)) && (doublePush & empty & allowed)) {
+                    addMove(Move(sq, lsb(doublePush), DOUBLE_PUSH), moves);
+                }
+            }
 
-                    for (int dx = -1; dx <= 1; dx += 2) {
-                        for (int dy = -1; dy <= 1; dy += 2) {
-                            for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
-                                Piece p = getPiece(r + i * dy, c + i * dx);
-                                if (p.getColor() != color) {
-                                    addMove(makeMove(piece, r + i * dy, c + i * dx), moves);
-                                }
-                                if (p.getType() != NONE) {
-                                    break;
-                                }
-                            }
-                        }
-                    }
+            Bitboard captures = pawnAttacks(toMove, sq) & enemy & allowed;
+            while (captures) {
+                int to = popLsb(captures);
+                addPawnMove(sq, to, CAPTURE, capturesOnly, moves);
+            }
 
-                    break;
-                case KING:
-                    for (int i = r - 1; i <= r + 1; i ++) {
-                        for (int j = c - 1; j <= c + 1; j ++) {
-                            Piece p = getPiece(i, j);
-                            if (!p.isInvalid() && p.getColor() != color) {
-                                addMove(makeMove(piece, i, j), moves);
-                            }
-                        }
-                    }
+            for (int dc = -1; dc <= 1; dc += 2) {
+                if (enPassant(r, c + dc, toMove) && enPassantIsLegal(toMove, sq, squareIndex(r + forward, c + dc), squareIndex(r, c + dc))) {
+                    addMove(Move(sq, squareIndex(r + forward, c + dc), EN_PASSANT), moves);
+                }
+            }
+        }
 
-                    if (canCastleLeft(toMove)) {
-                        addMove(makeMove(piece, r, c - 2), moves);
-                    }
-                    if (canCastleRight(toMove)) {
-                        addMove(makeMove(piece, r, c + 2), moves);
-                    }
-                    break;
+        for (int t = ROOK; t <= QUEEN; t ++) {
+            Bitboard pieces = pieceBB[toMove][t];
+            while (pieces) {
+                int sq = popLsb(pieces);
+
+                Bitboard targets = pieceAttacks((PieceType)t, sq, occupied) & ~own & evasionMask & targetMask;
+                if (pinned & squareBB(sq)) {
+                    targets &= lineBB(kingSq, sq);
+                }
+                while (targets) {
+                    int to = popLsb(targets);
+                    addMove(Move(sq, to, (enemy & squareBB(to)) ? CAPTURE : QUIET), moves);
+                }
+            }
+        }
+    }
+
+    if (kingBB) {
+        Bitboard targets = kingAttacks(kingSq) & ~own & targetMask;
+        Bitboard withoutKing = occupied & ~kingBB;
+        while (targets) {
+            int to = popLsb(targets);
+            if (!(attackersTo(to, withoutKing) & enemy)) {
+                addMove(Move(kingSq, to, (enemy & squareBB(to)) ? CAPTURE : QUIET), moves);
+            }
+        }
+
+        if (!checkers && !capturesOnly) {
+            if (canCastleLeft(toMove)) {
+                addMove(Move(kingSq, kingSq - 2, CASTLE_LEFT), moves);
+            }
+            if (canCastleRight(toMove)) {
+                addMove(Move(kingSq, kingSq + 2, CASTLE_RIGHT), moves);
             }
         }
     }
 }
 
 /**
- * This is basically the same as getAllMoves, but is more efficient as it
- * doesn't create the actual array. There is obviously a lot of code
- * duplication here, but I wasn't really going for pretty code in this project.
+ * Every piece of either color that attacks the square, given the occupancy.
+ * Passing a different occupancy from the board's lets callers ask what would
+ * be attacked after pieces move, e.g. with the king lifted off its square.
  */
-int Board::countNumMoves(Color toMove) {
-    int numMoves = 0;
-    for (int r = 1; r <= HEIGHT; r ++) {
-        for (int c = 1; c <= WIDTH; c ++) {
-            Piece piece = getPiece(r, c);
-            PieceType type = piece.getType();
-            Color color = piece.getColor();
-            
-            if (color != toMove) {
-                continue;
-            }
+Bitboard Board::attackersTo(int sq, Bitboard occupied) {
+    Bitboard rooks = pieceBB[WHITE][ROOK] | pieceBB[BLACK][ROOK] | pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN];
+    Bitboard bishops = pieceBB[WHITE][BISHOP] | pieceBB[BLACK][BISHOP] | pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN];
+
+    return (pawnAttacks(BLACK, sq) & pieceBB[WHITE][PAWN])
+        | (pawnAttacks(WHITE, sq) & pieceBB[BLACK][PAWN])
+        | (knightAttacks(sq) & (pieceBB[WHITE][KNIGHT] | pieceBB[BLACK][KNIGHT]))
+        | (kingAttacks(sq) & (pieceBB[WHITE][KING] | pieceBB[BLACK][KING]))
+        | (rookAttacks(sq, occupied) & rooks & occupied)
+        | (bishopAttacks(sq, occupied) & bishops & occupied);
+}
 
-            switch (type) {
-                case NONE:
-                    break;
-                case PAWN:
-                    if (color == WHITE) {
-                        if (r < HEIGHT && getPiece(r + 1, c).getType() == NONE) {
-                            numMoves++;
-                        }
-                        if (r == 2 && getPiece(r + 1, c).getType() == NONE && getPiece(r + 2, c).getType() == NONE) {
-                            numMoves++;
-                        }
-                        
-                        Piece diagLeft = getPiece(r + 1, c - 1);
-                        Piece diagRight = getPiece(r + 1, c + 1);
-                        if (!diagLeft.isInvalid() && diagLeft.getColor() == BLACK) {
-                            numMoves++;
-                        }
-                        if (!diagRight.isInvalid() && diagRight.getColor() == BLACK) {
-                            numMoves++;
-                        }
-                        
-                        if (enPassant(r, c - 1, WHITE)) {
-                            numMoves++;
-                        }
-                        if (enPassant(r, c + 1, WHITE)) {
-                            numMoves++;
-                        }
-                    } else {
-                        if (r > 1 && getPiece(r - 1, c).getType() == NONE) {
-                            numMoves++;
-                        }
-                        if (r == 7 && getPiece(r - 1, c).getType() == NONE && getPiece(r - 2, c).getType() == NONE) {
-                            numMoves++;
-                        }
-                        
-                        Piece diagLeft = getPiece(r - 1, c - 1);
-                        Piece diagRight = getPiece(r - 1, c + 1);
-                        if (!diagLeft.isInvalid() && diagLeft.getColor() == WHITE) {
-                            numMoves++;
-                        }
-                        if (!diagRight.isInvalid() && diagRight.getColor() == WHITE) {
-                            numMoves++;
-                        }
-
-                        if (enPassant(r, c - 1, BLACK)) {
-                            numMoves++;
-                        }
-                        if (enPassant(r, c + 1, BLACK)) {
-                            numMoves++;
-                        }
-                    }
-                    break;
-                case ROOK:
-                    for (int dy = -1; dy <= 1; dy ++) {
-                        for (int dx = -1; dx <= 1; dx ++) {
-                            if ((dx == 0) != (dy == 0)) {
-                                for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
-                                    Piece p = getPiece(r + i * dy, c + i * dx);
-                                    if (p.getColor() != color) {
-                                        numMoves++;
-                                    }
-                                    if (p.getType() != NONE) {
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    break;
-                case KNIGHT:
-                    for (int i = -2; i <= 2; i ++) {
-                        for (int j = -2; j <= 2; j ++) {
-                            if (abs(i) + abs(j) == 3) {
-                                Piece p = getPiece(r + i, c + j);
-                                if (!p.isInvalid() && p.getColor() != color) {
-                                    numMoves++;
-                                }
-                            }
-                        }
-                    }
-                    break;
-                case BISHOP:
-                    for (int dx = -1; dx <= 1; dx += 2) {
-                        for (int dy = -1; dy <= 1; dy += 2) {
-                            for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
-                                Piece p = getPiece(r + i * dy, c + i * dx);
-                                if (p.getColor() != color) {
-                                    numMoves++;
-                                }
-                                if (p.getType() != NONE) {
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                    break;
-                case QUEEN:
-                    for (int dy = -1; dy <= 1; dy ++) {
-                        for (int dx = -1; dx <= 1; dx ++) {
-                            if ((dx == 0) != (dy == 0)) {
-                                for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
-                                    Piece p = getPiece(r + i * dy, c + i * dx);
-                                    if (p.getColor() != color) {
-                                        numMoves++;
-                                    }
-                                    if (p.getType() != NONE) {
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-                    }
+/**
+ * Pieces of the given color that are the only thing standing between their
+ * king and an enemy slider on the same line.
+ */
+Bitboard Board::pinnedPieces(Color color, int kingSq) {
+    Color other = (color == WHITE) ? BLACK : WHITE;
+    Bitboard queens = pieceBB[other][QUEEN];
+    Bitboard snipers = (rookAttacks(kingSq, 0) & (pieceBB[other][ROOK] | queens))
+        | (bishopAttacks(kingSq, 0) & (pieceBB[other][BISHOP] | queens));
+
+    Bitboard pinned = 0;
+    while (snipers) {
+        int sq = popLsb(snipers);
+        Bitboard blockers = betweenBB(kingSq, sq) & occupancy[NOCOLOR];
+        if (popCount(blockers) == 1) {
+            pinned |= blockers & occupancy[color];
+        }
+    }
+    return pinned;
+}
 
-                    for (int dx = -1; dx <= 1; dx += 2) {
-                        for (int dy = -1; dy <= 1; dy += 2) {
-                            for (int i = 1; r + i * dy <= HEIGHT && r + i * dy >= 1 && c + i * dx <= WIDTH && c + i * dx >= 1; i ++) {
-                                Piece p = getPiece(r + i * dy, c + i * dx);
-                                if (p.getColor() != color) {
-                                    numMoves++;
-                                }
-                                if (p.getType() != NONE) {
-                                    break;
-                                }
-                            }
-                        }
-                    }
+/**
+ * Would capturing en passant from one square to another leave the king in
+ * check? The captured pawn may have been the checker, or the capture may
+ * remove both pawns from between the king and a rook on their rank, so this
+ * recomputes the attacks on the king with the occupancy after the capture.
+ */
+bool Board::enPassantIsLegal(Color toMove, int from, int to, int capturedSq) {
+    Bitboard kingBB = pieceBB[toMove][KING];
+    if (!kingBB) {
+        return true;
+    }
 
-                    break;
-                case KING:
-                    for (int i = r - 1; i <= r + 1; i ++) {
-                        for (int j = c - 1; j <= c + 1; j ++) {
-                            Piece p = getPiece(i, j);
-                            if (!p.isInvalid() && p.getColor() != color) {
-                                numMoves++;
-                            }
-                        }
-                    }
+    Color other = (toMove == WHITE) ? BLACK : WHITE;
+    int kingSq = lsb(kingBB);
+    Bitboard occupied = (occupancy[NOCOLOR] & ~squareBB(from) & ~squareBB(capturedSq)) | squareBB(to);
+    Bitboard queens = pieceBB[other][QUEEN];
 
-                    if (canCastleLeft(toMove)) {
-                        numMoves++;
-                    }
-                    if (canCastleRight(toMove)) {
-                        numMoves++;
-                    }
-                    break;
-            }
+    Bitboard attackers = (rookAttacks(kingSq, occupied) & (pieceBB[other][ROOK] | queens))
+        | (bishopAttacks(kingSq, occupied) & (pieceBB[other][BISHOP] | queens))
+        | (knightAttacks(kingSq) & pieceBB[other][KNIGHT])
+        | (pawnAttacks(toMove, kingSq) & pieceBB[other][PAWN] & ~squareBB(capturedSq));
+    return !attackers;
+}
+
+/**
+ * Squares attacked by a non-pawn piece of the given type standing on sq.
+ */
+Bitboard Board::pieceAttacks(PieceType type, int sq, Bitboard occupied) {
+    switch (type) {
+        case ROOK:
+            return rookAttacks(sq, occupied);
+        case KNIGHT:
+            return knightAttacks(sq);
+        case BISHOP:
+            return bishopAttacks(sq, occupied);
+        case QUEEN:
+            return queenAttacks(sq, occupied);
+        case KING:
+            return kingAttacks(sq);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Counts the squares each piece of one color could move to, for the
+ * evaluation. This is roughly the number of pseudo-legal moves, but it comes
+ * straight from the attack bitboards (and pawn pushes) without generating
+ * anything, and it leaves out en passant and castling, which would cost more
+ * to check than they are worth here.
+ */
+int Board::mobility(Color toMove) {
+    Color other = (toMove == WHITE) ? BLACK : WHITE;
+    Bitboard own = occupancy[toMove];
+    Bitboard enemy = occupancy[other];
+    Bitboard empty = ~occupancy[NOCOLOR];
+    Bitboard occupied = occupancy[NOCOLOR];
+    Bitboard pawns = pieceBB[toMove][PAWN];
+    int numMoves = 0;
+
+    Bitboard singlePushes;
+    Bitboard doublePushes;
+    Bitboard leftCaptures;
+    Bitboard rightCaptures;
+    if (toMove == WHITE) {
+        singlePushes = (pawns << WIDTH) & empty;
+        doublePushes = ((singlePushes & (RANK_2 << WIDTH)) << WIDTH) & empty;
+        leftCaptures = ((pawns & ~FILE_A) << (WIDTH - 1)) & enemy;
+        rightCaptures = ((pawns & ~FILE_H) << (WIDTH + 1)) & enemy;
+    } else {
+        singlePushes = (pawns >> WIDTH) & empty;
+        doublePushes = ((singlePushes & (RANK_7 >> WIDTH)) >> WIDTH) & empty;
+        leftCaptures = ((pawns & ~FILE_A) >> (WIDTH + 1)) & enemy;
+        rightCaptures = ((pawns & ~FILE_H) >> (WIDTH - 1)) & enemy;
+    }
+    numMoves += popCount(singlePushes) + popCount(doublePushes) + popCount(leftCaptures) + popCount(rightCaptures);
+
+    for (int t = ROOK; t <= KING; t ++) {
+        Bitboard pieces = pieceBB[toMove][t];
+        while (pieces) {
+            int sq = popLsb(pieces);
+            numMoves += popCount(pieceAttacks((PieceType)t, sq, occupied) & ~own);
         }
     }
 
     return numMoves;
 }
 
-std::pair<Move, double> Board::findBestMove(int depth, Color toMove, MPI_Comm comm, double alpha) {
-    *numCalls = *numCalls + 1;
+/**
+ * Finds the best move for toMove with a search of the given depth, shared
+ * between all the processes in comm. At each node, if there are at least as
+ * many moves as processes, the moves are dealt out between the processes, and
+ * each searches its moves alone. Otherwise the processes are split into one
+ * group per move, and each group searches its move together.
+ *
+ * Once a subtree belongs to a single process, comm is MPI_COMM_SELF and the
+ * search continues in searchSerial, which makes no MPI calls at all.
+ *
+ * As in the quiescence search, alpha is the score White is already sure of
+ * elsewhere in the tree and beta the score Black is. Each side narrows its own
+ * bound as it finds better moves, and once alpha >= beta the other side will
+ * never allow this position, so the rest of its moves are skipped. The search
+ * is fail-soft: a result outside of (alpha, beta) is only a bound on the true
+ * score, but it is still the best bound that was found rather than alpha or
+ * beta itself.
+ */
+std::pair<Move, double> Board::findBestMove(int depth, Color toMove, MPI_Comm comm, double alpha, double beta) {
+    if (comm == MPI_COMM_SELF) {
+        return searchSerial(depth, toMove, alpha, beta);
+    }
 
     int procID;
     int nproc;
@@ -750,6 +785,12 @@ std::pair<Move, double> Board::findBestMove(int depth, Color toMove, MPI_Comm co
     MPI_Comm_rank(comm, &procID);
     MPI_Comm_size(comm, &nproc);
 
+    if (nproc == 1) {
+        return searchSerial(depth, toMove, alpha, beta);
+    }
+
+    stats.nodes ++;
+
     double bestValue;
     if (toMove == WHITE) {
         bestValue = -infty;
@@ -758,7 +799,11 @@ std::pair<Move, double> Board::findBestMove(int depth, Color toMove, MPI_Comm co
     }
     Move bestMove;
 
-    std::vector< std::pair<double, Move> > moves;
+    // Once time is up, the processes still run their collectives, so that
+    // nobody is left waiting, but their serial subtrees return straight away.
+    timeIsUp();
+
+    MoveList moves;
     getAllMoves(toMove, moves);
 
     if (moves.size() == 0) {
@@ -773,56 +818,59 @@ std::pair<Move, double> Board::findBestMove(int depth, Color toMove, MPI_Comm co
     }
 
     if (nproc <= moves.size()) {
-        if (depth > 1) {
-            for (int i = 0; i < moves.size(); i ++) {
-                moves[i].first = evaluateMove(moves[i].second, 1, MPI_COMM_WORLD, 0);
-            }
-            
-            if (toMove == WHITE) {
-                std::sort(moves.begin(), moves.end(), comparePairsWhite);
-            } else {
-                std::sort(moves.begin(), moves.end(), comparePairsBlack);
-            }
-        }
+        // The transposition table is not used here, since processes could
+        // see different entries and disagree on the order of the moves.
+        orderMoves(moves, toMove, depth, Move(), true);
 
-        MPI_Comm newcomm;
-        MPI_Comm_split(comm, procID, procID, &newcomm);
+        // The processes tell each other about their best moves as they go,
+        // so that everyone searches with the narrowest window known.
+        SharedBounds sharedBounds(comm, toMove, alpha, beta);
+        shared = &sharedBounds;
 
         for (int i = procID; i < moves.size(); i += nproc) {
-            Move move = moves[i].second;
+            stats.boundsReceived += sharedBounds.poll();
+            if (abandoned()) {
+                break;
+            }
 
-            double value = evaluateMove(move, depth, newcomm, bestValue);
+            Move move = moves[i].move();
 
-            if (((toMove == BLACK && value <= alpha) || (toMove == WHITE && value >= alpha)) && bestMove.row1 != 0) {
-                if (toMove == WHITE) {
-                    bestValue = infty;
-                } else {
-                    bestValue = -infty;
-                }
-                bestMove = move;
+            double evaluateStart = (trace != NULL) ? MPI_Wtime() : 0;
+            double value = evaluateMove(move, depth, MPI_COMM_SELF, sharedBounds.getAlpha(), sharedBounds.getBeta());
+            if (trace != NULL) {
+                trace->record("evaluate", evaluateStart, MPI_Wtime(), algebraicNotation(move));
+            }
+
+            if (stopped) {
+                break;
+            }
+            // Another process cut the node off during the search, so the
+            // score may be wrong, but it no longer matters.
+            if (sharedBounds.isClosed()) {
+                stats.abandonedSubtrees ++;
                 break;
             }
 
-            if ((toMove == WHITE && value >= bestValue) || (toMove == BLACK && value <= bestValue)) {
-                bestValue = value;
-                bestMove = move;
+            sharedBounds.offer(value, move);
+            if (sharedBounds.isClosed()) {
+                stats.cutoffs ++;
+                if (i == procID) {
+                    stats.firstMoveCutoffs ++;
+                }
+                break;
             }
         }
 
-        MPI_Comm_free(&newcomm);
-
-        std::pair<double, int> sendBest(bestValue, bestMove.compress());
-        std::pair<double, int> globalBest;
-
-        double startTime = MPI_Wtime();
-        if (toMove == WHITE) {
-            MPI_Allreduce(&sendBest, &globalBest, 1, MPI_DOUBLE_INT, MPI_MAXLOC, comm);
-        } else {
-            MPI_Allreduce(&sendBest, &globalBest, 1, MPI_DOUBLE_INT, MPI_MINLOC, comm);
+        shared = NULL;
+        double finishStart = MPI_Wtime();
+        sharedBounds.finish();
+        double finishEnd = MPI_Wtime();
+        stats.commTime += finishEnd - finishStart;
+        if (trace != NULL) {
+            trace->record("share", finishStart, finishEnd);
         }
-        *reduceTime = *reduceTime + MPI_Wtime() - startTime;
-
-        return std::pair<Move, double>(Move(globalBest.second), globalBest.first);
+        bestValue = sharedBounds.getBestValue();
+        bestMove = sharedBounds.getBestMove();
     } else {
         int procsPerMove = (nproc + moves.size() - 1) / moves.size();
         int remainder = nproc % moves.size();
@@ -837,56 +885,771 @@ std::pair<Move, double> Board::findBestMove(int depth, Color toMove, MPI_Comm co
             moveIndex = remainder + (procID - remainder * procsPerMove) / (procsPerMove - 1);
         }
 
-        Move move = moves[moveIndex].second;
-        MPI_Comm newcomm;
-        MPI_Comm_split(comm, moveIndex, procID, &newcomm);
-        bestValue = evaluateMove(move, depth, newcomm, bestValue);
+        Move move = moves[moveIndex].move();
+        double splitStart = MPI_Wtime();
+        MPI_Comm newcomm = splitComm(comm, moveIndex, moves.size());
+        double splitEnd = MPI_Wtime();
+        stats.splitTime += splitEnd - splitStart;
+        if (trace != NULL) {
+            trace->record("split", splitStart, splitEnd);
+        }
+        bestValue = evaluateMove(move, depth, newcomm, alpha, beta);
         bestMove = move;
-        MPI_Comm_free(&newcomm);
-
-        std::pair<double, int> sendBest(bestValue, bestMove.compress());
-        std::pair<double, int> globalBest;
+    }
 
-        double startTime = MPI_Wtime();
-        if (toMove == WHITE) {
-            MPI_Allreduce(&sendBest, &globalBest, 1, MPI_DOUBLE_INT, MPI_MAXLOC, comm);
-        } else {
-            MPI_Allreduce(&sendBest, &globalBest, 1, MPI_DOUBLE_INT, MPI_MINLOC, comm);
-        }
-        *reduceTime = *reduceTime + MPI_Wtime() - startTime;
+    std::pair<double, int> sendBest(bestValue, bestMove.compress());
+    std::pair<double, int> globalBest;
 
-        return std::pair<Move, double>(Move(globalBest.second), globalBest.first);
+    double startTime = MPI_Wtime();
+    if (toMove == WHITE) {
+        MPI_Allreduce(&sendBest, &globalBest, 1, MPI_DOUBLE_INT, MPI_MAXLOC, comm);
+    } else {
+        MPI_Allreduce(&sendBest, &globalBest, 1, MPI_DOUBLE_INT, MPI_MINLOC, comm);
     }
+    double endTime = MPI_Wtime();
+    stats.commTime += endTime - startTime;
+    if (trace != NULL) {
+        trace->record("allreduce", startTime, endTime);
+    }
+
+    return std::pair<Move, double>(Move(globalBest.second), globalBest.first);
 }
 
-double Board::calculateScore() {
-    double score = 0;
-    for (int i = 1; i <= HEIGHT; i ++) {
-        for (int j = 1; j <= WIDTH; j ++) {
-            Piece piece = getPiece(i, j);
-            double value = piece.getValue();
-            if (piece.getColor() == WHITE) {
-                score += value;
-            } else {
-                score -= value;
-            }
-        }
+/**
+ * The communicator for this process's group when comm is split into one group
+ * per move, at a node with numMoves moves. The groups depend only on comm and
+ * the number of moves, so each split is only ever made once, and reused
+ * whenever the same pattern comes up again. Groups of one process get
+ * MPI_COMM_SELF, so that their subtrees take the serial path.
+ *
+ * Every process in comm visits the same nodes in the same order, so they all
+ * agree on whether a split is already cached.
+ */
+MPI_Comm Board::splitComm(MPI_Comm comm, int group, int numMoves) {
+    std::pair<MPI_Comm, int> pattern(comm, numMoves);
+    std::map<std::pair<MPI_Comm, int>, MPI_Comm>::iterator it = commCache.find(pattern);
+    if (it != commCache.end()) {
+        return it->second;
     }
 
-    score += countNumMoves(WHITE) * 0.01;
-    score -= countNumMoves(BLACK) * 0.01;
+    int procID;
+    MPI_Comm_rank(comm, &procID);
 
-    return score;
-}
+    MPI_Comm newcomm;
+    MPI_Comm_split(comm, group, procID, &newcomm);
 
-Piece Board::applyMove(Move move) {
-    Piece moved = getPiece(move.row1, move.col1);
-    Piece taken = getPiece(move.row2, move.col2);
+    int newSize;
+    MPI_Comm_size(newcomm, &newSize);
+    if (newSize == 1) {
+        MPI_Comm_free(&newcomm);
+        newcomm = MPI_COMM_SELF;
+    }
 
-    whiteCanEnPassant = 0;
-    blackCanEnPassant = 0;
+    commCache[pattern] = newcomm;
+    return newcomm;
+}
 
-    if (moved.getType() == KING) {
+/**
+ * Frees the communicators made by splitComm. Must be called by every process
+ * before MPI_Finalize.
+ */
+void Board::freeCommunicators() {
+    std::map<std::pair<MPI_Comm, int>, MPI_Comm>::iterator it;
+    for (it = commCache.begin(); it != commCache.end(); it ++) {
+        if (it->second != MPI_COMM_SELF) {
+            MPI_Comm_free(&it->second);
+        }
+    }
+    commCache.clear();
+}
+
+/**
+ * The search of a subtree by this process alone. This works the same way as
+ * findBestMove, but without any communication, so it can also make use of
+ * the transposition table and of the process's threads.
+ */
+std::pair<Move, double> Board::searchSerial(int depth, Color toMove, double alpha, double beta) {
+    stats.nodes ++;
+
+    double bestValue;
+    if (toMove == WHITE) {
+        bestValue = -infty;
+    } else {
+        bestValue = infty;
+    }
+    Move bestMove;
+
+    // Checking the clock at every node would be wasteful, so it is only read
+    // every TIME_CHECK_INTERVAL nodes. Once time is up, the search unwinds
+    // straight away.
+    if ((stats.nodes % TIME_CHECK_INTERVAL) == 0) {
+        timeIsUp();
+    }
+    if (shared != NULL) {
+        if ((stats.nodes % BOUND_POLL_INTERVAL) == 0) {
+            stats.boundsReceived += shared->poll();
+        }
+        shared->narrow(alpha, beta);
+    }
+    if (abandoned()) {
+        return std::pair<Move, double>(bestMove, 0);
+    }
+
+    // Any extra threads this process has join in (see LazySMP.cpp).
+    if (threads != NULL && depth >= MIN_THREADED_DEPTH && !threads->isBusy()) {
+        return threads->search(this, depth, toMove, alpha, beta);
+    }
+
+    uint64_t key = 0;
+    Move hashMove;
+    if (table != NULL) {
+        key = getHashKey(toMove);
+        TTResult entry;
+        stats.ttProbes ++;
+        if (table->probe(key, entry)) {
+            stats.ttHits ++;
+            hashMove = entry.move;
+            if (entry.depth >= depth) {
+                double score = TranspositionTable::scoreFromTT(entry.score, entry.depth, depth);
+                if (entry.bound == BOUND_EXACT) {
+                    return std::pair<Move, double>(entry.move, score);
+                }
+                if (entry.bound == BOUND_LOWER && score >= beta) {
+                    return std::pair<Move, double>(entry.move, score);
+                }
+                if (entry.bound == BOUND_UPPER && score <= alpha) {
+                    return std::pair<Move, double>(entry.move, score);
+                }
+            }
+        }
+    }
+
+    bool inCheck = findCheck(toMove);
+    double staticScore = inCheck ? 0 : calculateScore();
+
+    double prunedValue;
+    if (!inCheck && tryStaticPruning(depth, toMove, alpha, beta, staticScore, prunedValue)) {
+        stats.staticPrunes ++;
+        return std::pair<Move, double>(bestMove, prunedValue);
+    }
+    if (!inCheck && tryNullMove(depth, toMove, alpha, beta, staticScore, prunedValue)) {
+        stats.nullMovePrunes ++;
+        return std::pair<Move, double>(bestMove, prunedValue);
+    }
+
+    MoveList moves;
+    getAllMoves(toMove, moves);
+
+    if (moves.size() == 0) {
+        if (!inCheck) {
+            return std::pair<Move, double>(bestMove, 0);
+        }
+        if (toMove == BLACK) {
+            return std::pair<Move, double>(bestMove, 1000 + depth);
+        } else {
+            return std::pair<Move, double>(bestMove, -1000 - depth);
+        }
+    }
+
+    orderMoves(moves, toMove, depth, hashMove);
+
+    double originalAlpha = alpha;
+    double originalBeta = beta;
+
+    // Close to the leaves, a quiet move can only change the score by so
+    // much, so if even that wouldn't reach the window, the quiet moves after
+    // the first are skipped. Their score is taken to be that best case.
+    bool futile = false;
+    double futilityValue = 0;
+    if (!inCheck && depth <= FUTILITY_DEPTH) {
+        if (toMove == WHITE) {
+            futilityValue = staticScore + FUTILITY_MARGIN * depth;
+            futile = futilityValue <= alpha && alpha > -MATE_THRESHOLD;
+        } else {
+            futilityValue = staticScore - FUTILITY_MARGIN * depth;
+            futile = futilityValue >= beta && beta < MATE_THRESHOLD;
+        }
+    }
+
+    for (int i = 0; i < moves.size(); i ++) {
+        if (abandoned()) {
+            break;
+        }
+
+        Move move = moves[i].move();
+
+        if (futile && i > 0 && !move.isCapture() && !move.isPromotion() && !givesCheck(move)) {
+            stats.futilityPrunes ++;
+            if ((toMove == WHITE && futilityValue > bestValue) || (toMove == BLACK && futilityValue < bestValue)) {
+                bestValue = futilityValue;
+            }
+            continue;
+        }
+
+        // A quiet move this late in the order is unlikely to be best, so it
+        // is first searched less deeply, and only searched again at full
+        // depth if that says it improves on the window after all. The root's
+        // moves are all searched fully, as they are when it is split between
+        // processes, and so are checks, which often start a combination.
+        int reduction = 0;
+        if (ply > 0 && !inCheck && !move.isCapture() && !move.isPromotion() && moves[i].score < COUNTER_ORDER) {
+            reduction = lateMoveReduction(depth, i, moves[i].score);
+            if (reduction > 0 && givesCheck(move)) {
+                reduction = 0;
+            }
+        }
+
+        double value = evaluateMove(move, depth - reduction, MPI_COMM_SELF, alpha, beta);
+        if (reduction > 0) {
+            stats.reductions ++;
+            if ((toMove == WHITE && value > alpha) || (toMove == BLACK && value < beta)) {
+                stats.reSearches ++;
+                value = evaluateMove(move, depth, MPI_COMM_SELF, alpha, beta);
+            }
+        }
+
+        if (improveBounds(toMove, value, bestValue, alpha, beta)) {
+            bestMove = move;
+        }
+        if (alpha >= beta) {
+            stats.cutoffs ++;
+            if (i == 0) {
+                stats.firstMoveCutoffs ++;
+            }
+            recordCutoff(move, toMove, depth);
+            break;
+        }
+    }
+
+    if (table != NULL && !abandoned()) {
+        // A score outside the window the node was searched with is only a
+        // bound on its true score. Nodes below this one may have been
+        // searched with a window narrowed by another process since, so the
+        // narrowest one is used.
+        if (shared != NULL) {
+            shared->narrow(originalAlpha, originalBeta);
+        }
+        Bound bound = BOUND_EXACT;
+        if (bestValue >= originalBeta) {
+            bound = BOUND_LOWER;
+        } else if (bestValue <= originalAlpha) {
+            bound = BOUND_UPPER;
+        }
+        table->store(key, bestValue, bound, depth, bestMove);
+    }
+
+    return std::pair<Move, double>(bestMove, bestValue);
+}
+
+/**
+ * Pruning a node close to the leaves from its static score alone, which is
+ * given as score. Returns whether the node was pruned, with value set to its
+ * score if so.
+ *
+ * Reverse futility pruning: if the static score beats the window by more
+ * than any move of the opponent's in the few plies left is likely to win
+ * back, the node is cut off with the static score.
+ *
+ * Razoring: if the static score is so far short of the window that only a
+ * capture could plausibly help, the quiescence search is run instead of a
+ * full one, and if even that stays short of the window, its score is used.
+ *
+ * Neither is used for mate scores, where the static score says nothing.
+ */
+bool Board::tryStaticPruning(int depth, Color toMove, double alpha, double beta, double score, double& value) {
+    if (depth <= REVERSE_FUTILITY_DEPTH) {
+        double margin = REVERSE_FUTILITY_MARGIN * depth;
+        if (toMove == WHITE && score - margin >= beta && beta < MATE_THRESHOLD) {
+            value = score;
+            return true;
+        }
+        if (toMove == BLACK && score + margin <= alpha && alpha > -MATE_THRESHOLD) {
+            value = score;
+            return true;
+        }
+    }
+
+    if (depth <= RAZOR_DEPTH) {
+        if (toMove == WHITE && score + RAZOR_MARGIN <= alpha && alpha > -MATE_THRESHOLD) {
+            value = quiescence(toMove, alpha, beta);
+            return value <= alpha;
+        }
+        if (toMove == BLACK && score - RAZOR_MARGIN >= beta && beta < MATE_THRESHOLD) {
+            value = quiescence(toMove, alpha, beta);
+            return value >= beta;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Null-move pruning: if toMove is already doing so well that the opponent
+ * can't get back inside the window even if toMove passes, then a real move
+ * would do at least as well, and the node can be pruned. The opponent's
+ * reply to the pass is searched NULL_MOVE_REDUCTION plies less deeply than a
+ * real move, so this costs far less than searching the node. Returns whether
+ * the node was pruned, with value set to its score if so.
+ *
+ * This is only tried when the static score (given as score) already suggests
+ * it will work, never in check (where passing is illegal), never twice in a
+ * row, and never when toMove has only pawns left, since passing would then
+ * too often be better than any real move (zugzwang).
+ */
+bool Board::tryNullMove(int depth, Color toMove, double alpha, double beta, double score, double& value) {
+    if (depth < NULL_MOVE_MIN_DEPTH || ply == noNullMovePly || !hasPieces(toMove)) {
+        return false;
+    }
+    if (ply > 0 && ply <= MAX_SEARCH_DEPTH && currentLine[ply - 1].isNull()) {
+        return false;
+    }
+
+    if ((toMove == WHITE && score < beta) || (toMove == BLACK && score > alpha)) {
+        return false;
+    }
+
+    // The opponent only has to show whether it can get past beta (or alpha
+    // for Black), so the window is kept as narrow as possible.
+    Color other = (toMove == WHITE) ? BLACK : WHITE;
+    double nullAlpha = (toMove == WHITE) ? beta - NULL_WINDOW : alpha;
+    double nullBeta = (toMove == WHITE) ? beta : alpha + NULL_WINDOW;
+    int nullDepth = depth - 1 - NULL_MOVE_REDUCTION;
+
+    applyNullMove();
+    pushLine(Move());
+    if (nullDepth > 0) {
+        value = searchSerial(nullDepth, other, nullAlpha, nullBeta).second;
+    } else {
+        value = quiescence(other, nullAlpha, nullBeta);
+    }
+    popLine();
+    undoNullMove();
+
+    if (abandoned() || (toMove == WHITE && value < beta) || (toMove == BLACK && value > alpha)) {
+        return false;
+    }
+
+    // Near the end of the game, check with a reduced search of the node
+    // itself, without another null move, that passing wasn't the only way
+    // to get this score.
+    if (phase <= NULL_VERIFY_PHASE) {
+        int savedPly = noNullMovePly;
+        noNullMovePly = ply;
+        double verified = searchSerial(depth - NULL_MOVE_REDUCTION, toMove, nullAlpha, nullBeta).second;
+        noNullMovePly = savedPly;
+        if (abandoned() || (toMove == WHITE && verified < beta) || (toMove == BLACK && verified > alpha)) {
+            return false;
+        }
+    }
+
+    // A mate found after passing doesn't prove anything about the real
+    // moves, only that the node is outside the window.
+    if (value >= MATE_THRESHOLD || value <= -MATE_THRESHOLD) {
+        value = (toMove == WHITE) ? beta : alpha;
+    }
+    return true;
+}
+
+/**
+ * How many plies less deeply to search the quiet move at index in the move
+ * order, with the given history score, at a node of the given depth. Moves
+ * that come later are less likely to matter and are reduced more, but a move
+ * that often caused cutoffs elsewhere in the tree is reduced less.
+ */
+int Board::lateMoveReduction(int depth, int index, int score) {
+    if (depth < LMR_MIN_DEPTH || index < LMR_MIN_INDEX) {
+        return 0;
+    }
+
+    int reduction = (index >= LMR_LATE_INDEX && depth > LMR_MIN_DEPTH) ? 2 : 1;
+    if (score >= LMR_GOOD_HISTORY) {
+        reduction --;
+    }
+    return reduction;
+}
+
+/**
+ * Searches to depth 1, 2, 3, ... until the time limit (in seconds) runs out,
+ * and returns the result of the deepest search that finished. Each iteration
+ * is much cheaper than the next, so little time is lost on the shallow ones,
+ * and each leaves behind the best moves in the transposition table to be
+ * searched first in the next.
+ *
+ * An iteration is only started if it is predicted to finish in time, based on
+ * how much longer the last iteration took than the one before it. If the
+ * prediction is wrong, the search is abandoned when the time limit passes
+ * (see findBestMove) and its result thrown away. All processes in comm must
+ * call this together, and they all stop at the same depth.
+ */
+std::pair<Move, double> Board::findBestMoveTimed(double timeLimit, int maxDepth, Color toMove, MPI_Comm comm) {
+    int procID;
+    MPI_Comm_rank(comm, &procID);
+
+    double startTime = now();
+    double lastIterationTime = 0;
+    double growth = DEFAULT_ITERATION_GROWTH;
+
+    std::pair<Move, double> best;
+    previousBest = Move();
+
+    for (int depth = 1; depth <= maxDepth; depth ++) {
+        int keepGoing = 1;
+        if (procID == 0 && depth > 1) {
+            double elapsed = now() - startTime;
+            keepGoing = elapsed + lastIterationTime * growth < timeLimit;
+        }
+        double commStart = MPI_Wtime();
+        MPI_Bcast(&keepGoing, 1, MPI_INT, 0, comm);
+        double commEnd = MPI_Wtime();
+        stats.commTime += commEnd - commStart;
+        if (trace != NULL) {
+            trace->record("bcast", commStart, commEnd);
+        }
+        if (!keepGoing) {
+            break;
+        }
+
+        // The first iteration always runs to completion, so that there is
+        // always a move to return.
+        stopped = false;
+        if (depth > 1) {
+            deadline = startTime + timeLimit;
+        }
+
+        double iterationStart = now();
+        rootDepth = depth;
+        std::pair<Move, double> result = searchRoot(depth, toMove, comm);
+
+        deadline = 0;
+        int localStopped = stopped;
+        int anyStopped;
+        commStart = MPI_Wtime();
+        MPI_Allreduce(&localStopped, &anyStopped, 1, MPI_INT, MPI_LOR, comm);
+        commEnd = MPI_Wtime();
+        stats.commTime += commEnd - commStart;
+        if (trace != NULL) {
+            trace->record("allreduce", commStart, commEnd);
+        }
+        stopped = false;
+        if (anyStopped) {
+            break;
+        }
+
+        best = result;
+        previousBest = result.first;
+
+        double iterationTime = now() - iterationStart;
+        if (lastIterationTime > 0) {
+            growth = std::max(MIN_ITERATION_GROWTH, std::min(MAX_ITERATION_GROWTH, iterationTime / lastIterationTime));
+        }
+        lastIterationTime = iterationTime;
+
+        if (procID == 0) {
+            std::cout << "Depth " << depth << ": " << algebraicNotation(best.first) << ", " << best.second << " (" << now() - startTime << "s)" << std::endl;
+        }
+
+        // Nothing to gain from searching deeper once a forced mate is found.
+        if (fabs(best.second) >= MATE_THRESHOLD) {
+            break;
+        }
+    }
+
+    rootDepth = 0;
+    previousBest = Move();
+    return best;
+}
+
+/**
+ * Searches the current position to the given depth, distributing the work
+ * across the processes in comm either statically (findBestMove) or
+ * dynamically (see Scheduler.cpp).
+ */
+std::pair<Move, double> Board::searchRoot(int depth, Color toMove, MPI_Comm comm) {
+    double startTime = MPI_Wtime();
+
+    std::pair<Move, double> result;
+    if (dynamicScheduling) {
+        Scheduler scheduler(this, comm);
+        result = scheduler.search(depth, toMove);
+    } else {
+        result = findBestMove(depth, toMove, comm, -infty, infty);
+    }
+
+    if (trace != NULL) {
+        trace->record("search", startTime, MPI_Wtime(), "depth " + std::to_string(depth));
+    }
+    return result;
+}
+
+void Board::setDynamicScheduling(bool dynamic) {
+    dynamicScheduling = dynamic;
+}
+
+/**
+ * Wall clock time in seconds. This is used instead of MPI_Wtime by the serial
+ * search, so that threads other than the main one make no MPI calls.
+ */
+double Board::now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Has the deadline for the current search passed? Once it has, this keeps
+ * returning true until the next search starts.
+ */
+bool Board::timeIsUp() {
+    if (deadline > 0 && !stopped && now() >= deadline) {
+        stopped = true;
+    }
+    if (externalStop != NULL && *externalStop) {
+        stopped = true;
+    }
+    return stopped;
+}
+
+/**
+ * Should the subtree being searched be given up on? Either time is up, or
+ * the shared node above it has been cut off by another process.
+ */
+bool Board::abandoned() {
+    return stopped || (shared != NULL && shared->isClosed());
+}
+
+void Board::setThreads(LazySMP* pool) {
+    threads = pool;
+}
+
+/**
+ * Lets another thread stop this board's search early, by setting the flag.
+ */
+void Board::setExternalStop(std::atomic<bool>* flag) {
+    externalStop = flag;
+}
+
+/**
+ * Records a move (or a null move) made on the way down the search, so that
+ * ply and currentLine stay in step with the position. Every pushLine must be
+ * matched by a popLine once the move is undone.
+ */
+void Board::pushLine(Move move) {
+    if (ply < MAX_SEARCH_DEPTH) {
+        currentLine[ply] = move;
+    }
+    ply ++;
+}
+
+void Board::popLine() {
+    ply --;
+}
+
+/**
+ * Copies the position and search limits from another board, but nothing that
+ * belongs to that board's own search, such as its counters or undo stack.
+ */
+void Board::copyPosition(Board& other) {
+    for (int c = 0; c < 3; c ++) {
+        for (int t = 0; t < 7; t ++) {
+            pieceBB[c][t] = other.pieceBB[c][t];
+        }
+        occupancy[c] = other.occupancy[c];
+    }
+    for (int i = 0; i < MAILBOX_SIZE; i ++) {
+        mailbox[i] = other.mailbox[i];
+    }
+    midgameScore = other.midgameScore;
+    endgameScore = other.endgameScore;
+    phase = other.phase;
+    whiteKingPos = other.whiteKingPos;
+    blackKingPos = other.blackKingPos;
+    whiteCanEnPassant = other.whiteCanEnPassant;
+    blackCanEnPassant = other.blackCanEnPassant;
+    whiteCanCastleLeft = other.whiteCanCastleLeft;
+    blackCanCastleLeft = other.blackCanCastleLeft;
+    whiteCanCastleRight = other.whiteCanCastleRight;
+    blackCanCastleRight = other.blackCanCastleRight;
+    hashKey = other.hashKey;
+    undoStack.clear();
+
+    // The copy carries on the other board's line, so it knows how far it is
+    // from the root and which move it is answering.
+    ply = other.ply;
+    for (int i = 0; i < ply && i < MAX_SEARCH_DEPTH; i ++) {
+        currentLine[i] = other.currentLine[i];
+    }
+
+    deadline = other.deadline;
+    stopped = false;
+}
+
+/**
+ * Puts the moves in the order they should be searched, scoring each one from
+ * what is already known rather than by searching it:
+ * - The best move from an earlier search of this position (the hash move) is
+ *   the most likely to cause a cutoff, so it goes first. At the root, that is
+ *   the best move from the previous iteration of iterative deepening instead.
+ * - Then captures that don't lose material in the static exchange
+ *   evaluation, in MVV-LVA order.
+ * - Then the killer moves, which caused cutoffs in sibling positions at the
+ *   same ply, and the counter-move to the move that led here.
+ * - Then the remaining quiet moves, by how often they caused cutoffs anywhere
+ *   in the tree (the history heuristic).
+ * - Last, the captures that lose material, losing the least first.
+ *
+ * The killer, counter-move and history tables are filled in by recordCutoff,
+ * and differ between processes. When shared is set, the processes in a
+ * communicator are splitting the moves by index, so they must all agree on
+ * the order, and only the hash move and captures are used.
+ */
+void Board::orderMoves(MoveList& moves, Color toMove, int depth, Move hashMove, bool shared) {
+    int p = std::min(ply, MAX_SEARCH_DEPTH - 1);
+    Move counter;
+    Move* counterSlot = counterMove();
+    if (counterSlot != NULL) {
+        counter = *counterSlot;
+    }
+
+    for (int i = 0; i < moves.size(); i ++) {
+        Move move = moves[i].move();
+        int capture = mvvLva(move);
+        if (capture > 0) {
+            // A capture that loses material in the exchange goes last.
+            int exchange = see(move);
+            if (exchange >= 0) {
+                moves[i].score = CAPTURE_ORDER + capture;
+            } else {
+                moves[i].score = LOSING_CAPTURE_ORDER + exchange;
+            }
+        } else if (shared) {
+            moves[i].score = 0;
+        } else if (move == killers[p][0]) {
+            moves[i].score = KILLER_ORDER;
+        } else if (move == killers[p][1]) {
+            moves[i].score = KILLER_ORDER - 1;
+        } else if (move == counter) {
+            moves[i].score = COUNTER_ORDER;
+        } else {
+            moves[i].score = history[toMove][move.from()][move.to()];
+        }
+    }
+    moves.sort();
+
+    moves.moveToFront(hashMove);
+    if (depth == rootDepth) {
+        moves.moveToFront(previousBest);
+    }
+}
+
+/**
+ * Remembers a quiet move that caused a cutoff at the current ply, for
+ * orderMoves. Captures are already ordered well without this.
+ */
+void Board::recordCutoff(Move move, Color toMove, int depth) {
+    if (capturedPiece(move).getType() != NONE) {
+        return;
+    }
+
+    int p = std::min(ply, MAX_SEARCH_DEPTH - 1);
+    if (move != killers[p][0]) {
+        killers[p][1] = killers[p][0];
+        killers[p][0] = move;
+    }
+
+    Move* counterSlot = counterMove();
+    if (counterSlot != NULL) {
+        *counterSlot = move;
+    }
+
+    // Deeper cutoffs save more work, so they count for more. The scores are
+    // halved whenever one gets too big, so that they stay below the killers.
+    int& score = history[toMove][move.from()][move.to()];
+    score += depth * depth;
+    if (score >= MAX_HISTORY) {
+        ageHistory();
+    }
+}
+
+/**
+ * The entry in the counter-move table for the move that led to the current
+ * position, or NULL if that move isn't known.
+ */
+Move* Board::counterMove() {
+    if (ply == 0 || ply > MAX_SEARCH_DEPTH || currentLine[ply - 1].isNull()) {
+        return NULL;
+    }
+    Move previous = currentLine[ply - 1];
+    return &counterMoves[previous.from()][previous.to()];
+}
+
+/**
+ * Forgets the killer moves and weakens the history scores, at the start of
+ * a new search. The history still says something about the new position, so
+ * it isn't cleared completely.
+ */
+void Board::ageHistory() {
+    for (int p = 0; p < MAX_SEARCH_DEPTH; p ++) {
+        killers[p][0] = Move();
+        killers[p][1] = Move();
+    }
+    for (int c = 0; c < 3; c ++) {
+        for (int from = 0; from < NUM_SQUARES; from ++) {
+            for (int to = 0; to < NUM_SQUARES; to ++) {
+                history[c][from][to] /= 2;
+            }
+        }
+    }
+}
+
+/**
+ * The static score of the position, in pawns from White's perspective. The
+ * material and piece-square scores are kept up to date by setPiece, and are
+ * blended between their middlegame and endgame values by the game phase
+ * (see Evaluation.cpp). Each side also gets a hundredth of a pawn for every
+ * square its pieces can move to.
+ */
+double Board::calculateScore() {
+    stats.leafEvaluations ++;
+    int p = std::min(phase, MAX_PHASE);
+    double score = (midgameScore * p + endgameScore * (MAX_PHASE - p)) / (100.0 * MAX_PHASE);
+
+    score += mobility(WHITE) * 0.01;
+    score -= mobility(BLACK) * 0.01;
+
+    return score;
+}
+
+/**
+ * Plays a move on the board and returns the piece it captured (which is
+ * empty for a non-capture). Everything else needed to take the move back is
+ * pushed onto the undo stack, so every call must eventually be matched by a
+ * call to undoMove in reverse order, with the piece returned here.
+ */
+Piece Board::applyMove(Move move) {
+    int row1 = move.fromRow();
+    int col1 = move.fromCol();
+    int row2 = move.toRow();
+    int col2 = move.toCol();
+    Piece moved = getPiece(row1, col1);
+    Piece taken = getPiece(row2, col2);
+
+    UndoState state;
+    state.moved = moved;
+    state.whiteKingPos = whiteKingPos;
+    state.blackKingPos = blackKingPos;
+    state.whiteCanEnPassant = whiteCanEnPassant;
+    state.blackCanEnPassant = blackCanEnPassant;
+    state.whiteCanCastleLeft = whiteCanCastleLeft;
+    state.blackCanCastleLeft = blackCanCastleLeft;
+    state.whiteCanCastleRight = whiteCanCastleRight;
+    state.blackCanCastleRight = blackCanCastleRight;
+    state.hashKey = hashKey;
+    undoStack.push_back(state);
+
+    hashKey ^= castlingAndEnPassantKey();
+
+    whiteCanEnPassant = 0;
+    blackCanEnPassant = 0;
+
+    if (moved.getType() == KING) {
         if (moved.getColor() == WHITE) {
             whiteCanCastleLeft = false;
             whiteCanCastleRight = false;
@@ -896,89 +1659,497 @@ Piece Board::applyMove(Move move) {
         }
     }
 
-    if (whiteCanCastleLeft && (moved.getRow() == 1 && moved.getCol() == 1) || (taken.getRow() == 1 && taken.getCol() == 1)) {
+    // Moving a rook, or having it captured, loses the right to castle with it.
+    Bitboard touched = squareBB(move.from()) | squareBB(move.to());
+    if (touched & squareBB(squareIndex(1, 1))) {
         whiteCanCastleLeft = false;
     }
-    if (whiteCanCastleRight && (moved.getRow() == 1 && moved.getCol() == 8) || (taken.getRow() == 1 && taken.getCol() == 8)) {
-        whiteCanCastleLeft = false;
+    if (touched & squareBB(squareIndex(1, 8))) {
+        whiteCanCastleRight = false;
     }
-    if (blackCanCastleLeft && (moved.getRow() == 8 && moved.getCol() == 1) || (taken.getRow() == 8 && taken.getCol() == 1)) {
+    if (touched & squareBB(squareIndex(8, 1))) {
         blackCanCastleLeft = false;
     }
-    if (blackCanCastleRight && (moved.getRow() == 8 && moved.getCol() == 8) || (taken.getRow() == 8 && taken.getCol() == 8)) {
-        blackCanCastleLeft = false;
+    if (touched & squareBB(squareIndex(8, 8))) {
+        blackCanCastleRight = false;
     }
 
-    if (moved.getType() == KING && abs(move.col2 - move.col1) == 2) {
-        if (move.col2 == move.col1 - 2) {
-            setPiece(move.row1, move.col1 - 1, getPiece(move.row1, 1));
-            setPiece(move.row1, 1, Piece());
-        } else {
-            setPiece(move.row1, move.col1 + 1, getPiece(move.row1, 8));
-            setPiece(move.row1, 8, Piece());
-        }
+    if (move.flags() == CASTLE_LEFT) {
+        setPiece(row1, col1 - 1, getPiece(row1, 1));
+        setPiece(row1, 1, Piece());
+    } else if (move.flags() == CASTLE_RIGHT) {
+        setPiece(row1, col1 + 1, getPiece(row1, 8));
+        setPiece(row1, 8, Piece());
     }
 
-    if (moved.getType() == PAWN && move.col2 != move.col1 && taken.getType() == NONE) {
-        taken = getPiece(move.row1, move.col2);
+    // The pawn taken en passant is beside the square moved to.
+    int takenRow = move.isEnPassant() ? row1 : row2;
+    if (move.isEnPassant()) {
+        taken = getPiece(takenRow, col2);
     }
     
-    if (moved.getType() == PAWN && abs(move.row1 - move.row2) == 2) {
+    if (move.flags() == DOUBLE_PUSH) {
         if (moved.getColor() == BLACK) {
-            whiteCanEnPassant = move.col1;
+            whiteCanEnPassant = col1;
         } else {
-            blackCanEnPassant = move.col1;
+            blackCanEnPassant = col1;
         }
     }
 
-    setPiece(move.row1, move.col1, Piece());
+    setPiece(row1, col1, Piece());
 
-    setPiece(taken.getRow(), taken.getCol(), Piece());
+    if (taken.getType() != NONE) {
+        setPiece(takenRow, col2, Piece());
+    }
 
-    // This doesn't allow underpromotion, but it'll work like 99% of the time and it's not worth the extra complexity.
-    if (moved.getType() == PAWN && ( (moved.getColor() == WHITE && move.row2 == 8) || (moved.getColor() == BLACK && move.row2 == 1) )) {
-        setPiece(move.row2, move.col2, Piece(moved.getColor(), QUEEN));
+    if (move.isPromotion()) {
+        setPiece(row2, col2, Piece(moved.getColor(), move.promotion()));
     } else {
-        setPiece(move.row2, move.col2, moved);
-    }    
+        setPiece(row2, col2, moved);
+    }
+
+    hashKey ^= castlingAndEnPassantKey();
 
     return taken;
 }
 
-double Board::evaluateMove(Move move, int depth, MPI_Comm comm, double alpha) {
+/**
+ * Takes back the most recent move made by applyMove. Only the squares the
+ * move touched are rewritten; castling rights, en passant columns and king
+ * positions are restored from the undo stack.
+ */
+void Board::undoMove(Move move, Piece taken) {
+    UndoState& state = undoStack.back();
+    int row1 = move.fromRow();
+    int col1 = move.fromCol();
+
+    setPiece(move.toRow(), move.toCol(), Piece());
+    if (taken.getType() != NONE) {
+        setPiece(move.isEnPassant() ? row1 : move.toRow(), move.toCol(), taken);
+    }
+    setPiece(row1, col1, state.moved);
+
+    if (move.flags() == CASTLE_LEFT) {
+        setPiece(row1, 1, getPiece(row1, col1 - 1));
+        setPiece(row1, col1 - 1, Piece());
+    } else if (move.flags() == CASTLE_RIGHT) {
+        setPiece(row1, 8, getPiece(row1, col1 + 1));
+        setPiece(row1, col1 + 1, Piece());
+    }
+
+    whiteKingPos = state.whiteKingPos;
+    blackKingPos = state.blackKingPos;
+    whiteCanEnPassant = state.whiteCanEnPassant;
+    blackCanEnPassant = state.blackCanEnPassant;
+    whiteCanCastleLeft = state.whiteCanCastleLeft;
+    blackCanCastleLeft = state.blackCanCastleLeft;
+    whiteCanCastleRight = state.whiteCanCastleRight;
+    blackCanCastleRight = state.blackCanCastleRight;
+    hashKey = state.hashKey;
+
+    undoStack.pop_back();
+}
+
+/**
+ * Passes the turn, for null-move pruning. All a pass changes is that en
+ * passant is no longer possible. Must be matched by a call to undoNullMove.
+ */
+void Board::applyNullMove() {
+    UndoState state;
+    state.whiteCanEnPassant = whiteCanEnPassant;
+    state.blackCanEnPassant = blackCanEnPassant;
+    state.hashKey = hashKey;
+    undoStack.push_back(state);
+
+    hashKey ^= castlingAndEnPassantKey();
+    whiteCanEnPassant = 0;
+    blackCanEnPassant = 0;
+    hashKey ^= castlingAndEnPassantKey();
+}
+
+void Board::undoNullMove() {
+    UndoState& state = undoStack.back();
+    whiteCanEnPassant = state.whiteCanEnPassant;
+    blackCanEnPassant = state.blackCanEnPassant;
+    hashKey = state.hashKey;
+    undoStack.pop_back();
+}
+
+/**
+ * Does move put the opponent in check?
+ */
+bool Board::givesCheck(Move move) {
+    Piece moved = getPiece(move.fromRow(), move.fromCol());
+    Color other = (moved.getColor() == WHITE) ? BLACK : WHITE;
+    Piece taken = applyMove(move);
+    bool check = findCheck(other);
+    undoMove(move, taken);
+    return check;
+}
+
+/**
+ * Does color have anything besides its king and pawns? Without, zugzwang is
+ * too likely for a null move to be trusted.
+ */
+bool Board::hasPieces(Color color) {
+    return (occupancy[color] & ~(pieceBB[color][PAWN] | pieceBB[color][KING])) != 0;
+}
+
+double Board::evaluateMove(Move move, int depth, MPI_Comm comm, double alpha, double beta) {
     double value;
-    Board prevState = *this;
 
     Piece taken = applyMove(move);
 
+    Color toMove = getPiece(move.toRow(), move.toCol()).getColor();
+    Color other;
+    if (toMove == WHITE) {
+        other = BLACK;
+    } else {
+        other = WHITE;
+    }
+
     if (depth == 1) {
-        value = calculateScore();
+        value = quiescence(other, alpha, beta);
     } else {
-        Color toMove = getPiece(move.row2, move.col2).getColor();
-        Color other;
+        pushLine(move);
+        value = findBestMove(depth - 1, other, comm, alpha, beta).second;
+        popLine();
+    }
+
+    undoMove(move, taken);
+
+    return value;
+}
+
+/**
+ * Scores a position at the end of the main search by playing out captures
+ * until the position is quiet, so that a piece left hanging at the horizon
+ * isn't counted as safe. White's best score so far is alpha and Black's is
+ * beta; a line outside of (alpha, beta) won't be chosen by the player it is
+ * bad for, so there is no need to find its exact score.
+ *
+ * Out of check, the player to move may stand pat, i.e. stop capturing and
+ * take the static score. Captures are tried in MVV-LVA order (most valuable
+ * victim first, least valuable attacker breaking ties). Captures that can't
+ * bring the score back to alpha or beta even with DELTA_MARGIN to spare are
+ * skipped, and so are captures that lose material in the static exchange
+ * evaluation. In check, the static score means nothing, since the player
+ * may not be able to keep it, so there is no standing pat and every evasion
+ * is searched, captures first. Stalemate is only noticed in the main search.
+ */
+double Board::quiescence(Color toMove, double alpha, double beta) {
+    stats.quiescenceNodes ++;
+
+    // In check, every legal move is generated and searched. Otherwise the
+    // captures are only generated if standing pat doesn't already cause a
+    // cutoff.
+    bool inCheck = findCheck(toMove);
+
+    MoveList moves;
+    if (inCheck) {
+        getAllMoves(toMove, moves);
+        if (moves.size() == 0) {
+            if (toMove == BLACK) {
+                return 1000;
+            } else {
+                return -1000;
+            }
+        }
+    }
+
+    double bestValue;
+    if (inCheck) {
+        bestValue = (toMove == WHITE) ? -infty : infty;
+    } else {
+        bestValue = calculateScore();
+        if ((toMove == WHITE && bestValue >= beta) || (toMove == BLACK && bestValue <= alpha)) {
+            return bestValue;
+        }
+        if (toMove == WHITE && bestValue > alpha) {
+            alpha = bestValue;
+        }
+        if (toMove == BLACK && bestValue < beta) {
+            beta = bestValue;
+        }
+        getAllMoves(toMove, moves, true);
+    }
+
+    for (int i = 0; i < moves.size(); i ++) {
+        Move move = moves[i].move();
+        Piece victim = capturedPiece(move);
+
+        // Evasions are never pruned, since there is no static score to fall
+        // back on. Captures still go first.
+        if (inCheck) {
+            moves[i].score = mvvLva(move);
+            continue;
+        }
+
+        if (victim.getType() == NONE) {
+            moves[i].score = SKIP_SCORE;
+            continue;
+        }
+
+        if (!move.isPromotion()) {
+            if (toMove == WHITE && bestValue + victim.getValue() + DELTA_MARGIN < alpha) {
+                moves[i].score = SKIP_SCORE;
+                continue;
+            }
+            if (toMove == BLACK && bestValue - victim.getValue() - DELTA_MARGIN > beta) {
+                moves[i].score = SKIP_SCORE;
+                continue;
+            }
+        }
+
+        // Standing pat is always possible, so a capture that loses material
+        // in the exchange can't do better than that.
+        if (see(move) < 0) {
+            moves[i].score = SKIP_SCORE;
+            continue;
+        }
+
+        moves[i].score = mvvLva(move);
+    }
+
+    moves.sort();
+
+    for (int i = 0; i < moves.size() && moves[i].score != SKIP_SCORE; i ++) {
+        Move move = moves[i].move();
+        Piece taken = applyMove(move);
+        double value = quiescence(toMove == WHITE ? BLACK : WHITE, alpha, beta);
+        undoMove(move, taken);
+
         if (toMove == WHITE) {
-            other = BLACK;
+            if (value > bestValue) {
+                bestValue = value;
+            }
+            if (bestValue >= beta) {
+                break;
+            }
+            if (bestValue > alpha) {
+                alpha = bestValue;
+            }
+        } else {
+            if (value < bestValue) {
+                bestValue = value;
+            }
+            if (bestValue <= alpha) {
+                break;
+            }
+            if (bestValue < beta) {
+                beta = bestValue;
+            }
+        }
+    }
+
+    return bestValue;
+}
+
+/**
+ * The piece a move would capture, which for en passant is not on the square
+ * moved to. Empty for a non-capture.
+ */
+Piece Board::capturedPiece(Move move) {
+    if (move.isEnPassant()) {
+        return getPiece(move.fromRow(), move.toCol());
+    }
+    if (move.isCapture()) {
+        return getPiece(move.toRow(), move.toCol());
+    }
+    return Piece();
+}
+
+/**
+ * Most valuable victim, least valuable attacker: a sort key that puts the
+ * captures of the biggest pieces first, and among those, the captures made
+ * with the smallest piece. Non-captures score 0, below every capture.
+ */
+int Board::mvvLva(Move move) {
+    Piece victim = capturedPiece(move);
+    if (victim.getType() == NONE) {
+        return 0;
+    }
+    return (int)(victim.getValue() * 10 - getPiece(move.fromRow(), move.fromCol()).getValue());
+}
+
+/**
+ * Static exchange evaluation: how much material the side making move wins
+ * (or loses, if negative) on the destination square, in hundredths of a
+ * pawn, if both sides keep recapturing there with their least valuable piece
+ * for as long as it pays. No moves are played; the captures are worked out
+ * on a copy of the occupancy bitboard, and a slider that a capture uncovers
+ * behind another piece (an x-ray attacker) joins in when its line opens.
+ *
+ * gain[d] is what the side making the d-th capture has won if the exchange
+ * stops there. Either side may stop instead of recapturing, so the result is
+ * found by working back from the last capture.
+ */
+int Board::see(Move move) {
+    static const PieceType ORDER[6] = { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+
+    int from = move.from();
+    int to = move.to();
+    Piece moved = getPiece(move.fromRow(), move.fromCol());
+    Color side = moved.getColor();
+
+    int gain[32];
+    int d = 0;
+    gain[0] = SEE_VALUES[capturedPiece(move).getType()];
+    int onSquare = moved.getType();
+    if (move.isPromotion()) {
+        gain[0] += SEE_VALUES[move.promotion()] - SEE_VALUES[PAWN];
+        onSquare = move.promotion();
+    }
+
+    Bitboard occupied = occupancy[NOCOLOR] ^ squareBB(from);
+    if (move.isEnPassant()) {
+        occupied ^= squareBB(squareIndex(move.fromRow(), move.toCol()));
+    }
+    Bitboard queens = pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN];
+    Bitboard rooks = pieceBB[WHITE][ROOK] | pieceBB[BLACK][ROOK] | queens;
+    Bitboard bishops = pieceBB[WHITE][BISHOP] | pieceBB[BLACK][BISHOP] | queens;
+    Bitboard attackers = attackersTo(to, occupied) & occupied;
+
+    while (d < 31) {
+        side = (side == WHITE) ? BLACK : WHITE;
+        Bitboard own = attackers & occupancy[side];
+        if (own == 0) {
+            break;
+        }
+
+        int type = NONE;
+        Bitboard piece = 0;
+        for (int i = 0; i < 6; i ++) {
+            Bitboard candidates = own & pieceBB[side][ORDER[i]];
+            if (candidates) {
+                type = ORDER[i];
+                piece = squareBB(lsb(candidates));
+                break;
+            }
+        }
+
+        d ++;
+        gain[d] = SEE_VALUES[onSquare] - gain[d - 1];
+        // Neither side can do better than stopping here, whatever follows.
+        if (std::max(-gain[d - 1], gain[d]) < 0) {
+            break;
+        }
+
+        occupied ^= piece;
+        if (type == PAWN || type == BISHOP || type == QUEEN) {
+            attackers |= bishopAttacks(to, occupied) & bishops;
+        }
+        if (type == ROOK || type == QUEEN) {
+            attackers |= rookAttacks(to, occupied) & rooks;
+        }
+        attackers &= occupied;
+        onSquare = type;
+    }
+
+    while (d > 0) {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        d --;
+    }
+    return gain[0];
+}
+
+/**
+ * Counts the leaf nodes of the full game tree to the given depth (perft).
+ * Comparing the counts with known results for standard positions catches
+ * almost any bug in move generation or in applying and undoing moves, and
+ * timing it measures how fast they are. At depth 1 the moves are counted
+ * without being played.
+ */
+long Board::perft(int depth, Color toMove) {
+    MoveList moves;
+    getAllMoves(toMove, moves);
+
+    if (depth <= 1) {
+        return moves.size();
+    }
+
+    Color other = (toMove == WHITE) ? BLACK : WHITE;
+    long nodes = 0;
+    for (int i = 0; i < moves.size(); i ++) {
+        Move move = moves[i].move();
+        Piece taken = applyMove(move);
+        nodes += perft(depth - 1, other);
+        undoMove(move, taken);
+    }
+    return nodes;
+}
+
+/**
+ * Runs perft on the current position, printing the count below each root
+ * move (the divide), which narrows a wrong total down to the line it is in,
+ * followed by the total, the time taken and the nodes per second. The root
+ * moves are dealt out between the processes in comm, like the static split
+ * in findBestMove, and the counts are summed on process 0.
+ */
+long Board::perftDivide(int depth, Color toMove, MPI_Comm comm) {
+    int procID;
+    int nproc;
+    MPI_Comm_rank(comm, &procID);
+    MPI_Comm_size(comm, &nproc);
+
+    double startTime = MPI_Wtime();
+
+    MoveList moves;
+    getAllMoves(toMove, moves);
+
+    Color other = (toMove == WHITE) ? BLACK : WHITE;
+    std::vector<long> counts(moves.size(), 0);
+    for (int i = procID; i < moves.size(); i += nproc) {
+        Move move = moves[i].move();
+        if (depth <= 1) {
+            counts[i] = 1;
         } else {
-            other = WHITE;
+            Piece taken = applyMove(move);
+            counts[i] = perft(depth - 1, other);
+            undoMove(move, taken);
         }
+    }
 
-        value = findBestMove(depth - 1, other, comm, alpha).second;
+    std::vector<long> totals(moves.size(), 0);
+    if (moves.size() > 0) {
+        MPI_Reduce(&counts[0], &totals[0], moves.size(), MPI_LONG, MPI_SUM, 0, comm);
     }
 
-    *this = prevState;
+    double elapsed = MPI_Wtime() - startTime;
 
-    return value;
+    long nodes = 0;
+    for (int i = 0; i < moves.size(); i ++) {
+        nodes += totals[i];
+    }
+
+    if (procID == 0) {
+        for (int i = 0; i < moves.size(); i ++) {
+            std::cout << algebraicNotation(moves[i].move()) << ": " << totals[i] << std::endl;
+        }
+        std::cout << "Nodes: " << nodes << std::endl;
+        std::cout << "Time: " << elapsed << "s" << std::endl;
+        std::cout << "Nodes per second: " << (long)(nodes / elapsed) << std::endl;
+    }
+
+    return nodes;
 }
 
+/**
+ * The piece, the square it moves from and the square it moves to, followed by
+ * the piece a pawn promotes to, e.g. Pe7e8=N.
+ */
 std::string Board::algebraicNotation(Move move) {
-    Piece piece = getPiece(move.row1, move.col1);
+    Piece piece = getPiece(move.fromRow(), move.fromCol());
     std::stringstream ret;
-    ret << piece.getPieceSymbol() << COL_NAMES[move.col1] << move.row1 << COL_NAMES[move.col2] << move.row2;
+    ret << piece.getPieceSymbol() << COL_NAMES[move.fromCol()] << move.fromRow() << COL_NAMES[move.toCol()] << move.toRow();
+    if (move.isPromotion()) {
+        ret << "=" << Piece::getPieceSymbol(move.promotion(), piece.getColor());
+    }
     return ret.str();
 }
 
 Move Board::getInputMove(Color toMove) {
-    std::vector< std::pair<double, Move> > moves;
+    MoveList moves;
     getAllMoves(toMove, moves);
 
     if (moves.size() == 0) {
@@ -1083,9 +2254,9 @@ Move Board::getInputMove(Color toMove) {
 
         std::vector<Move> valid;
         for (int i = 0; i < moves.size(); i ++) {
-            Move move = moves[i].second;
-            Piece piece = getPiece(move.row1, move.col1);
-            if (piece.getType() == type && piece.getColor() == toMove && move.row2 == row && move.col2 == col) {
+            Move move = moves[i].move();
+            Piece piece = getPiece(move.fromRow(), move.fromCol());
+            if (piece.getType() == type && piece.getColor() == toMove && move.toRow() == row && move.toCol() == col) {
                 valid.push_back(move);
             }
         }
@@ -1093,9 +2264,9 @@ Move Board::getInputMove(Color toMove) {
         if (valid.size() == 1) {
             return valid[0];
         } else if (valid.size() > 1) {
-            std::cout << "Ambiguous move. Which piece would you like to move?" << std::endl;
+            std::cout << "Ambiguous move. Which move did you mean?" << std::endl;
             for (int i = 0; i < valid.size(); i ++) {
-                std::cout << "(" << i << ") " << COL_NAMES[valid[i].col1] << valid[i].row1 << " " << std::endl;
+                std::cout << "(" << i << ") " << algebraicNotation(valid[i]) << std::endl;
             }
 
             while (true) {
@@ -1112,103 +2283,131 @@ Move Board::getInputMove(Color toMove) {
     }
 }
 
-long Board::getNumCalls() {
-    return *numCalls;
+/**
+ * The statistics for searches by this board since they were last cleared.
+ * Boards belonging to helper threads keep their own (see LazySMP.cpp).
+ */
+SearchStats& Board::getStats() {
+    return stats;
 }
 
-double Board::getReduceTime() {
-    return *reduceTime;
+/**
+ * Records this board's parallel search on the given timeline (see Trace.cpp),
+ * or stops recording it if t is NULL.
+ */
+void Board::setTrace(Trace* t) {
+    trace = t;
+}
+
+Trace* Board::getTrace() {
+    return trace;
 }
 
 int main(int argc, char *argv[]) {
     Color toMove = WHITE;
     int depth = 1;
+    bool depthGiven = false;
+    bool dynamicScheduling = false;
+    int numThreads = 1;
+    int perftDepth = 0;
+    bool bench = false;
+    bool showStats = false;
+    char* traceFilename = NULL;
+    double timeLimit = 0;
+    int tableMegabytes = DEFAULT_TT_MEGABYTES;
     char* inputFilename = NULL;
     int opt = 0;
     Color playing = WHITE;
 
-    MPI_Init(&argc, &argv);
+    int threadSupport;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &threadSupport);
+    initBitboards();
+    initZobrist();
+    initEvaluation();
 
     do {
-        opt = getopt(argc, argv, "f:d:");
+        opt = getopt(argc, argv, "f:d:m:t:wj:p:bsT:");
         switch (opt) {
             case 'f':
                 inputFilename = optarg;
                 break;
             case 'd':
                 depth = atoi(optarg);
+                depthGiven = true;
+                break;
+            case 't':
+                timeLimit = atoi(optarg) / 1000.0;
+                break;
+            case 'm':
+                tableMegabytes = atoi(optarg);
+                break;
+            case 'w':
+                dynamicScheduling = true;
+                break;
+            case 'j':
+                numThreads = atoi(optarg);
+                break;
+            case 'p':
+                perftDepth = atoi(optarg);
+                break;
+            case 'b':
+                bench = true;
+                break;
+            case 's':
+                showStats = true;
+                break;
+            case 'T':
+                traceFilename = optarg;
                 break;
         }
     } while (opt != -1);
 
     Board* board = new Board();
+    board->setDynamicScheduling(dynamicScheduling);
 
-    if (inputFilename != NULL) {
-        MPI_File input;
-        MPI_File_open(MPI_COMM_WORLD, inputFilename, MPI_MODE_RDONLY, MPI_INFO_NULL, &input);
+    Trace* trace = NULL;
+    if (traceFilename != NULL) {
+        trace = new Trace(MPI_COMM_WORLD);
+        board->setTrace(trace);
+    }
 
-        char line[WIDTH + 1];
-        MPI_File_read(input, line, 2, MPI_CHAR, MPI_STATUS_IGNORE);
-        
-        if (line[0] == 'W' || line[0] == 'w') {
-            toMove = WHITE;
-        } else if (line[0] == 'B' || line[0] == 'b') {
-            toMove = BLACK;
+    TranspositionTable* table = NULL;
+    if (tableMegabytes > 0) {
+        table = new TranspositionTable(tableMegabytes, MPI_COMM_WORLD);
+        board->setTranspositionTable(table);
+    }
+
+    LazySMP* threads = NULL;
+    if (numThreads > 1) {
+        if (threadSupport < MPI_THREAD_FUNNELED) {
+            std::cout << "This MPI does not support MPI_THREAD_FUNNELED, so -j is ignored" << std::endl;
         } else {
+            threads = new LazySMP(numThreads, table);
+            board->setThreads(threads);
+        }
+    }
+
+    if (bench) {
+        std::vector<char*> files(argv + optind, argv + argc);
+        runBench(files, depthGiven ? depth : DEFAULT_BENCH_DEPTH, dynamicScheduling, numThreads, threads, table, trace, MPI_COMM_WORLD);
+
+        if (trace != NULL) {
+            trace->write(traceFilename, MPI_COMM_WORLD);
+        }
+        delete trace;
+        delete threads;
+        delete table;
+        board->freeCommunicators();
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (inputFilename != NULL) {
+        if (!board->readFile(inputFilename, toMove, MPI_COMM_WORLD)) {
             std::cout << "First line of input file must be W or B" << std::endl;
             return 1;
         }
-
         playing = toMove;
-        
-        for (int i = HEIGHT; i >= 1; i --) {
-            MPI_File_read(input, line, WIDTH + 1, MPI_CHAR, MPI_STATUS_IGNORE);
-            for (int j = 1; j <= WIDTH; j ++) {
-                Piece piece;
-                switch (line[j - 1]) {
-                    case 'P':
-                        piece = Piece(WHITE, PAWN);
-                        break;
-                    case 'p':
-                        piece = Piece(BLACK, PAWN);
-                        break;
-                    case 'R':
-                        piece = Piece(WHITE, ROOK);
-                        break;
-                    case 'r':
-                        piece = Piece(BLACK, ROOK);
-                        break;
-                    case 'N':
-                        piece = Piece(WHITE, KNIGHT);
-                        break;
-                    case 'n':
-                        piece = Piece(BLACK, KNIGHT);
-                        break;
-                    case 'B':
-                        piece = Piece(WHITE, BISHOP);
-                        break;
-                    case 'b':
-                        piece = Piece(BLACK, BISHOP);
-                        break;
-                    case 'Q':
-                        piece = Piece(WHITE, QUEEN);
-                        break;
-                    case 'q':
-                        piece = Piece(BLACK, QUEEN);
-                        break;
-                    case 'K':
-                        piece = Piece(WHITE, KING);
-                        break;
-                    case 'k':
-                        piece = Piece(BLACK, KING);
-                        break;
-                    case ' ':
-                        piece = Piece(NOCOLOR, NONE);
-                        break;
-                }
-                board->setPiece(i, j, piece);
-            }
-        }
     } else {
         board->initializeBoard();
     }
@@ -1219,42 +2418,45 @@ int main(int argc, char *argv[]) {
     MPI_Comm_rank(MPI_COMM_WORLD, &procID);
     MPI_Comm_size(MPI_COMM_WORLD, &nproc);
 
+    if (perftDepth > 0) {
+        if (procID == 0) {
+            board->printBoard();
+        }
+        board->perftDivide(perftDepth, toMove, MPI_COMM_WORLD);
+
+        delete threads;
+        delete table;
+        board->freeCommunicators();
+        MPI_Finalize();
+        return 0;
+    }
+
     while (true) {
         if (procID == 0) {
             board->printBoard();
         }
 
         if (toMove == playing) {
-            double alpha;
-            if (toMove == WHITE) {
-                alpha = infty;
-            } else {
-                alpha = -infty;
+            if (table != NULL) {
+                table->newSearch();
             }
+            board->ageHistory();
+            board->getStats().clear();
 
             double startTime = MPI_Wtime();
 
-            std::pair<Move, double> best = board->findBestMove(depth, toMove, MPI_COMM_WORLD, alpha);
-
-            double endTime = MPI_Wtime();
-
-            // Uncomment to print various diagnostic data
-            /*
-            if (procID == 0) {
-                std::cout << "Elapsed time for proc " << procID << ": " << endTime - startTime << std::endl;
+            std::pair<Move, double> best;
+            if (timeLimit > 0) {
+                best = board->findBestMoveTimed(timeLimit, depthGiven ? depth : MAX_SEARCH_DEPTH, toMove, MPI_COMM_WORLD);
+            } else {
+                best = board->searchRoot(depth, toMove, MPI_COMM_WORLD);
             }
 
-            long numCalls = board->getNumCalls();
-            std::cout << "Number of calls for proc " << procID << ": " << numCalls << std::endl;
-
-            std::cout << "Reduce time for proc " << procID << " = " << board->getReduceTime() << std::endl;
+            double endTime = MPI_Wtime();
 
-            long globalNumCalls;
-            MPI_Allreduce(&numCalls, &globalNumCalls, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
-            if (procID == 0) {
-                std::cout << "Total number of calls is " << globalNumCalls << std::endl;
+            if (showStats) {
+                board->getStats().print(endTime - startTime, MPI_COMM_WORLD);
             }
-            */
 
             std::pair<double, int> sendBest(best.second, best.first.compress());
             std::pair<double, int> globalBest;
@@ -1307,5 +2509,13 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (trace != NULL) {
+        trace->write(traceFilename, MPI_COMM_WORLD);
+    }
+    delete trace;
+    delete threads;
+    delete table;
+    board->freeCommunicators();
+
     MPI_Finalize();
 }
\ No newline at end of file
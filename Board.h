@@ -9,15 +9,159 @@
 #include <string>
 #include "Piece.h"
 #include "Move.h"
+#include "MoveList.h"
 #include <utility>
+#include <atomic>
+#include <map>
 #include "Position.h"
+#include "Bitboard.h"
+#include "Zobrist.h"
+#include "Evaluation.h"
+#include "SearchStats.h"
+#include "Trace.h"
+#include "SharedBounds.h"
+#include "TranspositionTable.h"
 #include "mpi.h"
 
+class LazySMP;
+
 const char COL_NAMES[9] = { '?', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h' };
 
+// The board is also kept as a 10x12 mailbox: the 8x8 board surrounded by a
+// border of invalid squares, one column wide at the sides and two rows deep
+// at the top and bottom, so that a step of up to one square (or a knight's
+// jump) off the board lands on the border rather than outside the array.
+const int MAILBOX_WIDTH = 10;
+const int MAILBOX_SIZE = 120;
+
+inline int mailboxIndex(int row, int col) {
+    return (row + 1) * MAILBOX_WIDTH + col;
+}
+
+// Room reserved up front on the undo stack, so that searches never need to
+// grow it. Deeper searches still work, they just reallocate.
+const int MAX_UNDO_DEPTH = 256;
+
+// Search limits and tuning for iterative deepening (see findBestMoveTimed).
+const int MAX_SEARCH_DEPTH = 64;
+const int TIME_CHECK_INTERVAL = 1024;
+const double DEFAULT_ITERATION_GROWTH = 6;
+const double MIN_ITERATION_GROWTH = 2;
+const double MAX_ITERATION_GROWTH = 20;
+
+// How often, in nodes, a subtree below a shared node checks for better bounds
+// from the other processes (see SharedBounds.cpp).
+const int BOUND_POLL_INTERVAL = 256;
+
+// Takes a move's score into account at a node where toMove is to move: if it
+// beats bestValue, it becomes the new bestValue, and it narrows toMove's own
+// side of the (alpha, beta) window. Returns whether the move is the new best.
+inline bool improveBounds(Color toMove, double value, double& bestValue, double& alpha, double& beta) {
+    if (toMove == WHITE) {
+        if (value <= bestValue) {
+            return false;
+        }
+        bestValue = value;
+        if (bestValue > alpha) {
+            alpha = bestValue;
+        }
+    } else {
+        if (value >= bestValue) {
+            return false;
+        }
+        bestValue = value;
+        if (bestValue < beta) {
+            beta = bestValue;
+        }
+    }
+    return true;
+}
+
+// How far short of alpha (or beta) a capture in the quiescence search may
+// leave the score, in pawns, before it is skipped without being searched.
+const double DELTA_MARGIN = 2;
+
+// Null-move pruning (see searchSerial): the side to move passes, and if the
+// opponent still can't get back inside the window with a search this much
+// shallower than usual, the node is pruned. In endgames with at most
+// NULL_VERIFY_PHASE of material left, where zugzwang is common enough that
+// passing may really be best, a pass that fails high is checked by a reduced
+// search of the node itself before it is trusted. NULL_WINDOW is how far
+// inside the window the opponent's search looks, just enough for it to be
+// able to fail either way.
+const int NULL_MOVE_MIN_DEPTH = 3;
+const int NULL_MOVE_REDUCTION = 2;
+const int NULL_VERIFY_PHASE = 6;
+const double NULL_WINDOW = 1e-6;
+
+// Pruning near the leaves using the static score, in pawns (see
+// searchSerial). Reverse futility pruning cuts off a node up to
+// REVERSE_FUTILITY_DEPTH plies from the leaves whose static score beats the
+// window by REVERSE_FUTILITY_MARGIN per ply. Razoring drops a node up to
+// RAZOR_DEPTH plies from the leaves straight into the quiescence search if its
+// static score is RAZOR_MARGIN short of the window. Futility pruning skips the
+// quiet moves at a node up to FUTILITY_DEPTH plies from the leaves whose
+// static score is FUTILITY_MARGIN per ply short of the window.
+const int REVERSE_FUTILITY_DEPTH = 3;
+const double REVERSE_FUTILITY_MARGIN = 1;
+const int RAZOR_DEPTH = 2;
+const double RAZOR_MARGIN = 3;
+const int FUTILITY_DEPTH = 2;
+const double FUTILITY_MARGIN = 1;
+
+// Late move reductions (see searchSerial): quiet moves from LMR_MIN_INDEX on
+// are searched a ply shallower, and from LMR_LATE_INDEX on two plies, unless
+// their history score is at least LMR_GOOD_HISTORY.
+const int LMR_MIN_DEPTH = 3;
+const int LMR_MIN_INDEX = 3;
+const int LMR_LATE_INDEX = 8;
+const int LMR_GOOD_HISTORY = 64;
+
+// Scores used by orderMoves to rank the kinds of moves. History scores are
+// kept below MAX_HISTORY, so that they never outrank a killer move.
+const int CAPTURE_ORDER = 3000000;
+const int KILLER_ORDER = 2000000;
+const int COUNTER_ORDER = 1000000;
+const int MAX_HISTORY = 500000;
+const int LOSING_CAPTURE_ORDER = -1000000;
+
+// Piece values for the static exchange evaluation (see Board::see), in
+// hundredths of a pawn, indexed by PieceType. The king is worth more than
+// everything else together, so that capturing with it into a defended square
+// never pays.
+const int SEE_VALUES[7] = { 0, 100, 500, 300, 300, 900, 10000 };
+
+/**
+ * The parts of the board state that a move can change irreversibly, saved by
+ * applyMove so that undoMove can restore them.
+ */
+struct UndoState {
+    Piece moved;
+    Position whiteKingPos;
+    Position blackKingPos;
+    int whiteCanEnPassant;
+    int blackCanEnPassant;
+    bool whiteCanCastleLeft;
+    bool blackCanCastleLeft;
+    bool whiteCanCastleRight;
+    bool blackCanCastleRight;
+    uint64_t hashKey;
+};
+
 class Board {
 private:
-    std::vector<Piece> board;
+    // pieceBB[color][type] has a bit set for each square holding that piece.
+    // occupancy[WHITE] and occupancy[BLACK] hold every piece of that color,
+    // and occupancy[NOCOLOR] holds every piece on the board.
+    Bitboard pieceBB[3][7];
+    Bitboard occupancy[3];
+    // The piece on every square, indexed by mailboxIndex.
+    Piece mailbox[MAILBOX_SIZE];
+    // The sums of pieceSquareMidgame and pieceSquareEndgame over every piece
+    // on the board, and the game phase (see Evaluation.cpp).
+    int midgameScore = 0;
+    int endgameScore = 0;
+    int phase = 0;
     Position whiteKingPos;
     Position blackKingPos;
     int whiteCanEnPassant = 0;
@@ -26,31 +170,95 @@ private:
     bool blackCanCastleLeft = false;
     bool whiteCanCastleRight = false;
     bool blackCanCastleRight = false;
-    long* numCalls;
-    double* reduceTime;
+    std::vector<UndoState> undoStack;
+    uint64_t hashKey = 0;
+    TranspositionTable* table = NULL;
+    double deadline = 0;
+    bool stopped = false;
+    int rootDepth = 0;
+    Move previousBest;
+    bool dynamicScheduling = false;
+    LazySMP* threads = NULL;
+    std::atomic<bool>* externalStop = NULL;
+    std::map<std::pair<MPI_Comm, int>, MPI_Comm> commCache;
+    // The node whose moves this process is searching a share of, if any.
+    SharedBounds* shared = NULL;
+    // The ply where a null move may not be tried, while it is being verified.
+    int noNullMovePly = -1;
+
+    // Move ordering tables (see orderMoves). ply counts the moves made since
+    // the root of the search, and currentLine holds those moves.
+    int ply = 0;
+    Move currentLine[MAX_SEARCH_DEPTH];
+    Move killers[MAX_SEARCH_DEPTH][2];
+    Move counterMoves[NUM_SQUARES][NUM_SQUARES];
+    int history[3][NUM_SQUARES][NUM_SQUARES] = {};
+    SearchStats stats;
+    Trace* trace = NULL;
 public:
     Board();
     Piece getPiece(int row, int col);
     Piece getPiece(Position pos);
     void setPiece(int row, int col, Piece piece);
     void initializeBoard();
+    uint64_t castlingAndEnPassantKey();
+    uint64_t getHashKey(Color toMove);
+    void setTranspositionTable(TranspositionTable* tt);
     void printBoard();
-    Move makeMove(Piece piece, int row, int col);
     double calculateScore();
-    double evaluateMove(Move move, int depth, MPI_Comm comm, double alpha);
+    double evaluateMove(Move move, int depth, MPI_Comm comm, double alpha, double beta);
+    double quiescence(Color toMove, double alpha, double beta);
+    Piece capturedPiece(Move move);
+    int mvvLva(Move move);
+    int see(Move move);
     Piece applyMove(Move move);
     void undoMove(Move move, Piece taken);
-    std::pair<Move, double> findBestMove(int depth, Color toMove, MPI_Comm comm, double alpha);
+    void applyNullMove();
+    void undoNullMove();
+    bool givesCheck(Move move);
+    bool hasPieces(Color color);
+    int lateMoveReduction(int depth, int index, int score);
+    bool tryNullMove(int depth, Color toMove, double alpha, double beta, double score, double& value);
+    bool tryStaticPruning(int depth, Color toMove, double alpha, double beta, double score, double& value);
+    std::pair<Move, double> findBestMove(int depth, Color toMove, MPI_Comm comm, double alpha, double beta);
+    std::pair<Move, double> searchSerial(int depth, Color toMove, double alpha, double beta);
+    MPI_Comm splitComm(MPI_Comm comm, int group, int numMoves);
+    void freeCommunicators();
+    std::pair<Move, double> findBestMoveTimed(double timeLimit, int maxDepth, Color toMove, MPI_Comm comm);
+    std::pair<Move, double> searchRoot(int depth, Color toMove, MPI_Comm comm);
+    void setDynamicScheduling(bool dynamic);
+    static double now();
+    bool timeIsUp();
+    bool abandoned();
+    void setThreads(LazySMP* pool);
+    void setExternalStop(std::atomic<bool>* flag);
+    void copyPosition(Board& other);
+    void pushLine(Move move);
+    void popLine();
+    void orderMoves(MoveList& moves, Color toMove, int depth, Move hashMove, bool shared = false);
+    void recordCutoff(Move move, Color toMove, int depth);
+    Move* counterMove();
+    void ageHistory();
     bool findCheck(Color toMove);
+    bool isAttacked(int sq, Color attacker);
+    Bitboard attackersTo(int sq, Bitboard occupied);
+    Bitboard pinnedPieces(Color color, int kingSq);
+    bool enPassantIsLegal(Color toMove, int from, int to, int capturedSq);
     bool isValidMove(Move move);
+    long perft(int depth, Color toMove);
+    long perftDivide(int depth, Color toMove, MPI_Comm comm);
     std::string algebraicNotation(Move move);
-    void addMove(Move move, std::vector< std::pair<double, Move> >& moves);
+    void addMove(Move move, MoveList& moves);
+    void addPawnMove(int from, int to, int flags, bool capturesOnly, MoveList& moves);
     bool enPassant(int row, int col, Color toMove);
     bool canCastleLeft(Color toMove);
     bool canCastleRight(Color toMove);
-    void getAllMoves(Color toMove, std::vector< std::pair<double, Move> >& moves);
-    int countNumMoves(Color toMove);
+    Bitboard pieceAttacks(PieceType type, int sq, Bitboard occupied);
+    void getAllMoves(Color toMove, MoveList& moves, bool capturesOnly = false);
+    int mobility(Color toMove);
     Move getInputMove(Color toMove);
-    long getNumCalls();
-    double getReduceTime();
+    bool readFile(const char* filename, Color& toMove, MPI_Comm comm);
+    SearchStats& getStats();
+    void setTrace(Trace* t);
+    Trace* getTrace();
 };
\ No newline at end of file
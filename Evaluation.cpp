@@ -0,0 +1,144 @@
+/**
+ * @file Evaluation.cpp
+ * @author Greg Loose (gloose)
+ * @brief Tables for the static evaluation. Every (color, piece, square) has a
+ * score in hundredths of a pawn from White's perspective: the piece's
+ * material value plus a bonus or penalty for where it stands. Board keeps the sum of these over all
+ * of its pieces up to date as pieces come and go, like the Zobrist hash, so
+ * evaluating a position never needs to look at every square. The scores are
+ * integers so that adding and removing pieces always cancels out exactly.
+ *
+ * There are two sets of scores, one for the middlegame and one for the
+ * endgame, which Board blends according to how much material is left (the
+ * game phase). Only the king differs between the two: it should hide behind
+ * its pawns while there is still an attack to fear, and come to the centre
+ * once there isn't.
+ *
+ * The square bonuses are based on Tomasz Michniewski's "Simplified
+ * Evaluation Function".
+ *
+ * @date 2022-05-04
+ */
+
+#include "Evaluation.h"
+
+int pieceSquareMidgame[3][7][WIDTH * HEIGHT];
+int pieceSquareEndgame[3][7][WIDTH * HEIGHT];
+int phaseWeights[7] = { 0, 0, 2, 1, 1, 4, 0 };
+
+// Each table is laid out as White sees the board, with row 8 first, and is
+// flipped vertically for Black.
+static const int PAWN_SQUARES[WIDTH * HEIGHT] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     50,  50,  50,  50,  50,  50,  50,  50,
+     10,  10,  20,  30,  30,  20,  10,  10,
+      5,   5,  10,  25,  25,  10,   5,   5,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      5,  -5, -10,   0,   0, -10,  -5,   5,
+      5,  10,  10, -20, -20,  10,  10,   5,
+      0,   0,   0,   0,   0,   0,   0,   0
+};
+
+static const int ROOK_SQUARES[WIDTH * HEIGHT] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+      5,  10,  10,  10,  10,  10,  10,   5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+      0,   0,   0,   5,   5,   0,   0,   0
+};
+
+static const int KNIGHT_SQUARES[WIDTH * HEIGHT] = {
+    -50, -40, -30, -30, -30, -30, -40, -50,
+    -40, -20,   0,   0,   0,   0, -20, -40,
+    -30,   0,  10,  15,  15,  10,   0, -30,
+    -30,   5,  15,  20,  20,  15,   5, -30,
+    -30,   0,  15,  20,  20,  15,   0, -30,
+    -30,   5,  10,  15,  15,  10,   5, -30,
+    -40, -20,   0,   5,   5,   0, -20, -40,
+    -50, -40, -30, -30, -30, -30, -40, -50
+};
+
+static const int BISHOP_SQUARES[WIDTH * HEIGHT] = {
+    -20, -10, -10, -10, -10, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,  10,  10,   5,   0, -10,
+    -10,   5,   5,  10,  10,   5,   5, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,  10,  10,  10,  10,  10,  10, -10,
+    -10,   5,   0,   0,   0,   0,   5, -10,
+    -20, -10, -10, -10, -10, -10, -10, -20
+};
+
+static const int QUEEN_SQUARES[WIDTH * HEIGHT] = {
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,   5,   5,   5,   0, -10,
+     -5,   0,   5,   5,   5,   5,   0,  -5,
+      0,   0,   5,   5,   5,   5,   0,  -5,
+    -10,   5,   5,   5,   5,   5,   0, -10,
+    -10,   0,   5,   0,   0,   0,   0, -10,
+    -20, -10, -10,  -5,  -5, -10, -10, -20
+};
+
+static const int KING_MIDGAME_SQUARES[WIDTH * HEIGHT] = {
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -20, -30, -30, -40, -40, -30, -30, -20,
+    -10, -20, -20, -20, -20, -20, -20, -10,
+     20,  20,   0,   0,   0,   0,  20,  20,
+     20,  30,  10,   0,   0,  10,  30,  20
+};
+
+static const int KING_ENDGAME_SQUARES[WIDTH * HEIGHT] = {
+    -50, -40, -30, -20, -20, -30, -40, -50,
+    -30, -20, -10,   0,   0, -10, -20, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -30,   0,   0,   0,   0, -30, -30,
+    -50, -30, -30, -30, -30, -30, -30, -50
+};
+
+static const int* const MIDGAME_SQUARES[7] = {
+    0, PAWN_SQUARES, ROOK_SQUARES, KNIGHT_SQUARES, BISHOP_SQUARES, QUEEN_SQUARES, KING_MIDGAME_SQUARES
+};
+
+static const int* const ENDGAME_SQUARES[7] = {
+    0, PAWN_SQUARES, ROOK_SQUARES, KNIGHT_SQUARES, BISHOP_SQUARES, QUEEN_SQUARES, KING_ENDGAME_SQUARES
+};
+
+void initEvaluation() {
+    for (int c = 0; c < 3; c ++) {
+        for (int t = 0; t < 7; t ++) {
+            for (int sq = 0; sq < WIDTH * HEIGHT; sq ++) {
+                // Empty squares never contribute to the score.
+                if (c == NOCOLOR || t == NONE) {
+                    pieceSquareMidgame[c][t][sq] = 0;
+                    pieceSquareEndgame[c][t][sq] = 0;
+                    continue;
+                }
+
+                // The tables start from the row furthest from the piece's own
+                // side, which is row 8 for White but row 1 for Black.
+                int index = (c == WHITE) ? (sq ^ (WIDTH * (HEIGHT - 1))) : sq;
+                int value = (int)(Piece((Color)c, (PieceType)t).getValue() * 100);
+                int midgame = value + MIDGAME_SQUARES[t][index];
+                int endgame = value + ENDGAME_SQUARES[t][index];
+
+                if (c == WHITE) {
+                    pieceSquareMidgame[c][t][sq] = midgame;
+                    pieceSquareEndgame[c][t][sq] = endgame;
+                } else {
+                    pieceSquareMidgame[c][t][sq] = -midgame;
+                    pieceSquareEndgame[c][t][sq] = -endgame;
+                }
+            }
+        }
+    }
+}
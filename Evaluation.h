@@ -0,0 +1,19 @@
+/**
+ * @file Evaluation.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include "Piece.h"
+#include "Position.h"
+
+// The game phase runs from MAX_PHASE with all the pieces on the board down
+// to 0 with only kings and pawns left.
+const int MAX_PHASE = 24;
+
+extern int pieceSquareMidgame[3][7][WIDTH * HEIGHT];
+extern int pieceSquareEndgame[3][7][WIDTH * HEIGHT];
+extern int phaseWeights[7];
+
+void initEvaluation();
@@ -0,0 +1,136 @@
+/**
+ * @file LazySMP.cpp
+ * @author Greg Loose (gloose)
+ * @brief Threaded search within one process, so that a machine's cores can
+ * be used without running one MPI process per core. MPI then only needs to
+ * distribute work between machines.
+ *
+ * This uses the "Lazy SMP" approach: rather than dividing up the moves, every
+ * thread searches the same position at once, each on its own copy of the
+ * board, and they share their results through the transposition table.
+ * Threads quickly end up in different parts of the tree, since each one skips
+ * whatever the others have already stored, and half of the helper threads
+ * search one ply deeper than asked to spread them out further. Only the
+ * calling thread's result is used; the helpers are stopped as soon as it has
+ * finished.
+ *
+ * Threads only ever run Board::searchSerial, which makes no MPI calls, so MPI
+ * only needs to be initialized with MPI_THREAD_FUNNELED.
+ *
+ * @date 2022-05-04
+ */
+
+#include "LazySMP.h"
+
+/**
+ * Starts numThreads - 1 helper threads. The thread that calls search is the
+ * remaining one.
+ */
+LazySMP::LazySMP(int numThreads, TranspositionTable* table) {
+    stop = false;
+    for (int i = 0; i < numThreads - 1; i ++) {
+        Board* helperBoard = new Board();
+        helperBoard->setTranspositionTable(table);
+        helperBoard->setExternalStop(&stop);
+        boards.push_back(helperBoard);
+    }
+
+    for (int i = 0; i < numThreads - 1; i ++) {
+        helpers.push_back(std::thread(&LazySMP::helperLoop, this, i));
+    }
+}
+
+LazySMP::~LazySMP() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+
+    for (int i = 0; i < helpers.size(); i ++) {
+        helpers[i].join();
+        delete boards[i];
+    }
+}
+
+/**
+ * Is a threaded search already running? Nodes below it are searched by each
+ * thread on its own.
+ */
+bool LazySMP::isBusy() {
+    return busy;
+}
+
+/**
+ * Searches the board's current position with all threads, returning the
+ * calling thread's result.
+ */
+std::pair<Move, double> LazySMP::search(Board* board, int d, Color color, double a, double b) {
+    busy = true;
+    stop = false;
+
+    // The helpers are all idle between searches, so their boards are safe
+    // to overwrite.
+    for (int i = 0; i < boards.size(); i ++) {
+        boards[i]->copyPosition(*board);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        depth = d;
+        toMove = color;
+        alpha = a;
+        beta = b;
+        running = helpers.size();
+        generation ++;
+    }
+    wake.notify_all();
+
+    std::pair<Move, double> result = board->searchSerial(d, color, a, b);
+
+    stop = true;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running > 0) {
+            done.wait(lock);
+        }
+    }
+
+    // The helpers' work counts towards this process's statistics.
+    for (int i = 0; i < boards.size(); i ++) {
+        board->getStats().add(boards[i]->getStats());
+        boards[i]->getStats().clear();
+    }
+
+    busy = false;
+    return result;
+}
+
+void LazySMP::helperLoop(int index) {
+    int seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        while (!quit && generation == seen) {
+            wake.wait(lock);
+        }
+        if (quit) {
+            return;
+        }
+        seen = generation;
+
+        int helperDepth = depth + (index % 2);
+        Color helperToMove = toMove;
+        double helperAlpha = alpha;
+        double helperBeta = beta;
+        lock.unlock();
+
+        boards[index]->searchSerial(helperDepth, helperToMove, helperAlpha, helperBeta);
+
+        lock.lock();
+        running --;
+        if (running == 0) {
+            done.notify_all();
+        }
+    }
+}
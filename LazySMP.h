@@ -0,0 +1,42 @@
+/**
+ * @file LazySMP.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include <vector>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "Board.h"
+
+// Serial subtrees shallower than this are searched by one thread alone, since
+// waking the helpers would cost more than they could save.
+const int MIN_THREADED_DEPTH = 3;
+
+class LazySMP {
+private:
+    std::vector<std::thread> helpers;
+    std::vector<Board*> boards;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::atomic<bool> stop;
+    int generation = 0;
+    int running = 0;
+    bool quit = false;
+    bool busy = false;
+    int depth = 0;
+    Color toMove = NOCOLOR;
+    double alpha = 0;
+    double beta = 0;
+    void helperLoop(int index);
+public:
+    LazySMP(int numThreads, TranspositionTable* table);
+    ~LazySMP();
+    bool isBusy();
+    std::pair<Move, double> search(Board* board, int depth, Color toMove, double alpha, double beta);
+};
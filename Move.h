@@ -1,20 +1,64 @@
 /**
  * @file Move.h
  * @author Greg Loose (gloose)
+ * @brief This class represents a move, by which a player moves a piece from
+ * one position to another. A move fits in 16 bits: 6 each for the squares it
+ * moves from and to, and 4 flags saying what kind of move it is (see
+ * MoveFlag). The flags are set when the move is generated, so that applying
+ * and undoing it never has to work out from the board whether it was a
+ * capture, castling, en passant or a promotion, and so that a pawn can
+ * promote to any piece. The same 16 bits are what is sent in MPI messages
+ * and stored in the transposition table. Everything is defined here, since
+ * moves are made and taken apart at every node of the search.
+ *
  * @date 2022-05-04
  */
 
 #pragma once
+#include <stdint.h>
 #include "Piece.h"
 
+/**
+ * The kind of move, stored in the top 4 bits of a Move. CAPTURE is a bit of
+ * its own, so that a promotion can also be a capture, and the promotion
+ * piece is stored in the low 2 bits of a promotion, counting from ROOK.
+ */
+enum MoveFlag {
+    QUIET = 0,
+    DOUBLE_PUSH = 1,
+    CASTLE_RIGHT = 2,
+    CASTLE_LEFT = 3,
+    CAPTURE = 4,
+    EN_PASSANT = 5,
+    PROMOTION = 8
+};
+
 class Move {
+private:
+    uint16_t data = 0;
 public:
-    int row1 = 0;
-    int col1 = 0;
-    int row2 = 0;
-    int col2 = 0;
-    Move();
-    Move(int r1, int c1, int r2, int c2);
-    Move(int compressed);
-    int compress();
-};
\ No newline at end of file
+    Move() {}
+    Move(int from, int to, int flags) : data((uint16_t)(from | (to << 6) | (flags << 12))) {}
+    Move(int compressed) : data((uint16_t)compressed) {}
+    int compress() const { return data; }
+
+    // Squares are indexed from 0 (see Bitboard.h), while rows and columns
+    // start at 1, as everywhere else in Board.
+    int from() const { return data & 0x3F; }
+    int to() const { return (data >> 6) & 0x3F; }
+    int flags() const { return data >> 12; }
+    int fromRow() const { return (from() >> 3) + 1; }
+    int fromCol() const { return (from() & 7) + 1; }
+    int toRow() const { return (to() >> 3) + 1; }
+    int toCol() const { return (to() & 7) + 1; }
+
+    bool isNull() const { return data == 0; }
+    bool isCapture() const { return flags() & CAPTURE; }
+    bool isEnPassant() const { return flags() == EN_PASSANT; }
+    bool isCastle() const { return flags() == CASTLE_LEFT || flags() == CASTLE_RIGHT; }
+    bool isPromotion() const { return flags() & PROMOTION; }
+    PieceType promotion() const { return (PieceType)(ROOK + (flags() & 3)); }
+
+    bool operator==(const Move& other) const { return data == other.data; }
+    bool operator!=(const Move& other) const { return data != other.data; }
+};
@@ -0,0 +1,82 @@
+/**
+ * @file MoveList.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include <stdint.h>
+#include <limits.h>
+#include <algorithm>
+#include "Move.h"
+
+// No legal position has more moves than this (the most known is 218).
+const int MAX_MOVES = 256;
+
+// A score that sorts after every other, for moves that are not to be
+// searched at all.
+const int SKIP_SCORE = INT_MIN;
+
+/**
+ * A move and the key it is sorted by. The move is kept as its 16 bits, so
+ * that a MoveList can be declared without constructing all of its entries.
+ */
+struct ScoredMove {
+    int score;
+    uint16_t bits;
+
+    Move move() const { return Move(bits); }
+};
+
+/**
+ * The moves from one position, in a fixed-size array. Each search call keeps
+ * its list on the stack, so that the recursion never allocates memory, which
+ * matters most with several threads sharing one allocator (see LazySMP.cpp).
+ */
+class MoveList {
+private:
+    ScoredMove entries[MAX_MOVES];
+    int count = 0;
+public:
+    int size() const { return count; }
+    ScoredMove& operator[](int i) { return entries[i]; }
+
+    void add(Move move) {
+        entries[count].score = 0;
+        entries[count].bits = move.compress();
+        count ++;
+    }
+
+    /**
+     * Sorts the moves by decreasing score, keeping moves with equal scores in
+     * the order they were generated. An insertion sort is fastest for lists
+     * this short, and unlike std::stable_sort needs no buffer.
+     */
+    void sort() {
+        for (int i = 1; i < count; i ++) {
+            ScoredMove entry = entries[i];
+            int j = i;
+            while (j > 0 && entries[j - 1].score < entry.score) {
+                entries[j] = entries[j - 1];
+                j --;
+            }
+            entries[j] = entry;
+        }
+    }
+
+    /**
+     * Moves the given move, if it is in the list, to the front of the list,
+     * keeping the order of the others.
+     */
+    void moveToFront(Move move) {
+        if (move.isNull()) {
+            return;
+        }
+        for (int i = 0; i < count; i ++) {
+            if (entries[i].bits == move.compress()) {
+                std::rotate(entries, entries + i, entries + i + 1);
+                return;
+            }
+        }
+    }
+};
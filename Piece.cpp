@@ -2,8 +2,9 @@
  * @file Piece.cpp
  * @author Greg Loose (gloose)
  * @brief This file contains various operations involving the Pieces that
- * make up the game board grid. See getPieceSymbol for details on piece
- * symbols, which are used in the input files.
+ * make up the game board grid. A Piece is a single byte, so that the whole
+ * board fits in two cache lines (see Board::getPiece). See getPieceSymbol
+ * for details on piece symbols, which are used in the input files.
  * 
  * @date 2022-05-04
  */
@@ -11,38 +12,8 @@
 #include "Piece.h"
 #include <limits>
 
-Piece::Piece() {
-    color = NOCOLOR;
-    type = NONE;
-    invalid = false;
-}
-
-Piece::Piece(bool inv) {
-    color = NOCOLOR;
-    type = NONE;
-    invalid = inv;
-}
-
-Piece::Piece(Color c, PieceType t) {
-    color = c;
-    type = t;
-    invalid = false;
-}
-
-Color Piece::getColor() {
-    return color;
-}
-
-PieceType Piece::getType() {
-    return type;
-}
-
-bool Piece::isInvalid() {
-    return invalid;
-}
-
 std::string Piece::getPieceSymbol() {
-    return getPieceSymbol(type, color);
+    return getPieceSymbol(getType(), getColor());
 }
 
 /**
@@ -91,21 +62,9 @@ std::string Piece::getPieceSymbol(PieceType type, Color color) {
     }
 }
 
-void Piece::setPos(int r, int c) {
-    row = r;
-    col = c;
-}
-
-int Piece::getRow() {
-    return row;
-}
-
-int Piece::getCol() {
-    return col;
-}
 
 double Piece::getValue() {
-    switch (type) {
+    switch (getType()) {
         case PAWN:
             return 1;
         case ROOK:
@@ -5,6 +5,7 @@
  */
 
 #pragma once
+#include <stdint.h>
 #include <string>
 
 enum Color {
@@ -23,24 +24,25 @@ enum PieceType {
     KING
 };
 
+// Set in a Piece's code for the squares around the edge of the board (see
+// Board::getPiece).
+const uint8_t INVALID_PIECE = 0x20;
+
+/**
+ * A piece, or an empty square, in one byte: the type in the low 3 bits and
+ * the color in the next 2.
+ */
 class Piece {
 private:
-    PieceType type;
-    Color color;
-    bool invalid;
-    int row = 0;
-    int col = 0;
+    uint8_t code;
 public:
-    Piece();
-    Piece(bool inv);
-    Piece(Color c, PieceType t);
-    Color getColor();
-    PieceType getType();
-    bool isInvalid();
+    Piece() : code(0) {}
+    Piece(bool inv) : code(inv ? INVALID_PIECE : 0) {}
+    Piece(Color c, PieceType t) : code((uint8_t)(t | (c << 3))) {}
+    Color getColor() const { return (Color)((code >> 3) & 3); }
+    PieceType getType() const { return (PieceType)(code & 7); }
+    bool isInvalid() const { return code & INVALID_PIECE; }
     std::string getPieceSymbol();
     static std::string getPieceSymbol(PieceType type, Color color);
-    void setPos(int r, int c);
-    int getRow();
-    int getCol();
     double getValue();
 };
@@ -0,0 +1,265 @@
+/**
+ * @file Scheduler.cpp
+ * @author Greg Loose (gloose)
+ * @brief Dynamic distribution of the search across processes. This is an
+ * alternative to the static split in Board::findBestMove, where each process
+ * is assigned a fixed share of the moves up front. Subtrees vary enormously in
+ * size (compare a line that ends in checkmate with a quiet middlegame line),
+ * so with a static split most processes end up waiting for the slowest one.
+ *
+ * Here process 0 is a master that keeps a queue of jobs, each one a subtree
+ * identified by the moves leading to it from the root. Every other process is
+ * a worker that asks the master for a job whenever it is idle, searches it on
+ * its own, and sends back the score with its next request. Jobs are handed
+ * out with the (alpha, beta) window narrowed by the scores found so far, so
+ * later jobs prune more.
+ *
+ * Following the Young Brothers Wait idea, the first (eldest) move at the root
+ * is searched before any of its brothers, so that they all get a good bound.
+ * To keep the workers busy meanwhile, the eldest move is itself split into one
+ * job per reply. The remaining root moves are then each a job of their own.
+ *
+ * @date 2022-05-04
+ */
+
+#include "Scheduler.h"
+#include <limits>
+
+#define infty std::numeric_limits<double>::infinity()
+
+const int TAG_RESULT = 1;
+const int TAG_JOB = 2;
+const int TAG_DONE = 3;
+
+Scheduler::Scheduler(Board* b, MPI_Comm c) {
+    board = b;
+    comm = c;
+    MPI_Comm_rank(comm, &procID);
+    MPI_Comm_size(comm, &nproc);
+    outstanding = 0;
+}
+
+/**
+ * Finds the best move for toMove with a search of the given depth. This is
+ * collective over the communicator, and every process gets the same result.
+ */
+std::pair<Move, double> Scheduler::search(int depth, Color toMove) {
+    if (nproc == 1) {
+        return board->findBestMove(depth, toMove, comm, -infty, infty);
+    }
+
+    std::pair<double, int> best;
+    if (procID == 0) {
+        std::pair<Move, double> result = runMaster(depth, toMove);
+        best = std::pair<double, int>(result.second, result.first.compress());
+    } else {
+        runWorker();
+    }
+
+    double startTime = MPI_Wtime();
+    MPI_Bcast(&best, 1, MPI_DOUBLE_INT, 0, comm);
+    record("bcast", startTime, board->getStats().commTime);
+    return std::pair<Move, double>(Move(best.second), best.first);
+}
+
+std::pair<Move, double> Scheduler::runMaster(int depth, Color toMove) {
+    Color other = (toMove == WHITE) ? BLACK : WHITE;
+    MoveList moves;
+    board->getAllMoves(toMove, moves);
+
+    // Too small to be worth splitting up.
+    if (moves.size() == 0 || depth == 1) {
+        std::pair<Move, double> result = board->findBestMove(depth, toMove, MPI_COMM_SELF, -infty, infty);
+        finishWorkers();
+        return result;
+    }
+
+    board->orderMoves(moves, toMove, depth, Move());
+
+    // Search the eldest brother first, one job per reply.
+    Move eldest = moves[0].move();
+    Piece taken = board->applyMove(eldest);
+    MoveList replies;
+    board->getAllMoves(other, replies);
+    if (replies.size() > 0) {
+        board->orderMoves(replies, other, depth - 1, Move());
+    }
+    board->undoMove(eldest, taken);
+
+    double eldestValue;
+    if (replies.size() == 0) {
+        eldestValue = board->evaluateMove(eldest, depth, MPI_COMM_SELF, -infty, infty);
+    } else {
+        std::vector<Job> jobs(replies.size());
+        for (int i = 0; i < replies.size(); i ++) {
+            jobs[i].id = i;
+            jobs[i].depth = depth - 1;
+            jobs[i].pathLength = 2;
+            jobs[i].path[0] = eldest;
+            jobs[i].path[1] = replies[i].move();
+        }
+        std::vector<double> results;
+        double alpha = -infty;
+        double beta = infty;
+        runJobs(jobs, results, other, alpha, beta);
+        eldestValue = (other == WHITE) ? alpha : beta;
+    }
+
+    // Then all of its younger brothers at once.
+    double bestValue = eldestValue;
+    Move bestMove = eldest;
+
+    std::vector<Job> jobs(moves.size() - 1);
+    for (int i = 1; i < moves.size(); i ++) {
+        jobs[i - 1].id = i - 1;
+        jobs[i - 1].depth = depth;
+        jobs[i - 1].pathLength = 1;
+        jobs[i - 1].path[0] = moves[i].move();
+    }
+    std::vector<double> results;
+    double alpha = (toMove == WHITE) ? bestValue : -infty;
+    double beta = (toMove == BLACK) ? bestValue : infty;
+    runJobs(jobs, results, toMove, alpha, beta);
+
+    // A result that only ties the best so far may just be a bound on a worse
+    // score, since the job was searched with the best so far as its window.
+    for (int i = 0; i < results.size(); i ++) {
+        double value = results[i];
+        if ((toMove == WHITE && value > bestValue) || (toMove == BLACK && value < bestValue)) {
+            bestValue = value;
+            bestMove = moves[i + 1].move();
+        }
+    }
+
+    finishWorkers();
+    return std::pair<Move, double>(bestMove, bestValue);
+}
+
+/**
+ * Hands out the jobs, all children of one node where nodeToMove is to move,
+ * to workers as they become idle, and waits for all of their results. The
+ * node's (alpha, beta) window is sent out with each job, and nodeToMove's side
+ * of it is narrowed as results come in.
+ */
+void Scheduler::runJobs(std::vector<Job>& jobs, std::vector<double>& results, Color nodeToMove, double& alpha, double& beta) {
+    results.assign(jobs.size(), (nodeToMove == WHITE) ? -infty : infty);
+    int next = 0;
+
+    while (true) {
+        while (next < jobs.size() && !idleWorkers.empty()) {
+            if (board->timeIsUp()) {
+                // The result will be thrown away, so don't start anything new.
+                next = jobs.size();
+                break;
+            }
+            int worker = idleWorkers.back();
+            idleWorkers.pop_back();
+            jobs[next].alpha = alpha;
+            jobs[next].beta = beta;
+            sendJob(worker, jobs[next]);
+            next ++;
+        }
+
+        if (next >= jobs.size() && outstanding == 0) {
+            break;
+        }
+
+        JobResult result;
+        MPI_Status status;
+        double waitStart = MPI_Wtime();
+        MPI_Recv(&result, sizeof(JobResult), MPI_BYTE, MPI_ANY_SOURCE, TAG_RESULT, comm, &status);
+        record("wait", waitStart, board->getStats().waitTime);
+        idleWorkers.push_back(status.MPI_SOURCE);
+
+        // A worker's first request carries no result.
+        if (result.id < 0) {
+            continue;
+        }
+        outstanding --;
+        results[result.id] = result.value;
+        if (nodeToMove == WHITE && result.value > alpha) {
+            alpha = result.value;
+        }
+        if (nodeToMove == BLACK && result.value < beta) {
+            beta = result.value;
+        }
+    }
+}
+
+/**
+ * Adds the time since start to total, and records it on the board's trace.
+ */
+void Scheduler::record(const char* name, double start, double& total) {
+    double end = MPI_Wtime();
+    total += end - start;
+    if (board->getTrace() != NULL) {
+        board->getTrace()->record(name, start, end);
+    }
+}
+
+void Scheduler::sendJob(int worker, Job& job) {
+    MPI_Send(&job, sizeof(Job), MPI_BYTE, worker, TAG_JOB, comm);
+    outstanding ++;
+}
+
+/**
+ * Waits until every worker is asking for work, and tells them all that this
+ * search is over.
+ */
+void Scheduler::finishWorkers() {
+    while (idleWorkers.size() < nproc - 1) {
+        JobResult result;
+        MPI_Status status;
+        double waitStart = MPI_Wtime();
+        MPI_Recv(&result, sizeof(JobResult), MPI_BYTE, MPI_ANY_SOURCE, TAG_RESULT, comm, &status);
+        record("wait", waitStart, board->getStats().waitTime);
+        idleWorkers.push_back(status.MPI_SOURCE);
+    }
+
+    for (int i = 0; i < idleWorkers.size(); i ++) {
+        MPI_Send(NULL, 0, MPI_BYTE, idleWorkers[i], TAG_DONE, comm);
+    }
+    idleWorkers.clear();
+}
+
+/**
+ * Searches jobs from the master until told the search is over. Each job's
+ * moves are played on this process's board, the last move is evaluated with
+ * a serial search, and the moves are taken back.
+ */
+void Scheduler::runWorker() {
+    JobResult result;
+    result.id = -1;
+    result.value = 0;
+
+    while (true) {
+        MPI_Send(&result, sizeof(JobResult), MPI_BYTE, 0, TAG_RESULT, comm);
+
+        Job job;
+        MPI_Status status;
+        double waitStart = MPI_Wtime();
+        MPI_Recv(&job, sizeof(Job), MPI_BYTE, 0, MPI_ANY_TAG, comm, &status);
+        record("idle", waitStart, board->getStats().idleTime);
+        if (status.MPI_TAG == TAG_DONE) {
+            break;
+        }
+
+        // The path moves are part of the line, so the search below knows it
+        // is not at the root and which move it is answering.
+        std::vector<Piece> taken;
+        for (int i = 0; i < job.pathLength - 1; i ++) {
+            taken.push_back(board->applyMove(job.path[i]));
+            board->pushLine(job.path[i]);
+        }
+        result.id = job.id;
+        double evaluateStart = MPI_Wtime();
+        result.value = board->evaluateMove(job.path[job.pathLength - 1], job.depth, MPI_COMM_SELF, job.alpha, job.beta);
+        if (board->getTrace() != NULL) {
+            board->getTrace()->record("evaluate", evaluateStart, MPI_Wtime(), "job " + std::to_string(job.id));
+        }
+        for (int i = job.pathLength - 2; i >= 0; i --) {
+            board->popLine();
+            board->undoMove(job.path[i], taken[i]);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+/**
+ * @file Scheduler.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include <vector>
+#include <utility>
+#include "Board.h"
+#include "mpi.h"
+
+// A job is a subtree of the root: the moves leading to it from the root,
+// followed by a search of the given depth from there.
+const int MAX_JOB_PATH = 2;
+
+struct Job {
+    int id;
+    int depth;
+    int pathLength;
+    Move path[MAX_JOB_PATH];
+    double alpha;
+    double beta;
+};
+
+struct JobResult {
+    int id;
+    double value;
+};
+
+class Scheduler {
+private:
+    Board* board;
+    MPI_Comm comm;
+    int procID;
+    int nproc;
+    std::vector<int> idleWorkers;
+    int outstanding;
+    std::pair<Move, double> runMaster(int depth, Color toMove);
+    void runWorker();
+    void runJobs(std::vector<Job>& jobs, std::vector<double>& results, Color nodeToMove, double& alpha, double& beta);
+    void sendJob(int worker, Job& job);
+    void record(const char* name, double start, double& total);
+    void finishWorkers();
+public:
+    Scheduler(Board* b, MPI_Comm c);
+    std::pair<Move, double> search(int depth, Color toMove);
+};
@@ -0,0 +1,143 @@
+/**
+ * @file SearchStats.cpp
+ * @author Greg Loose (gloose)
+ * @brief Statistics about a search, for diagnosing slow searches. Every Board
+ * counts its own nodes, cutoffs, transposition table use and time spent in
+ * MPI, and they are combined over all processes with MPI_Reduce once the
+ * search is over. With -s, the totals are printed after every search.
+ *
+ * @date 2022-05-04
+ */
+
+#include "SearchStats.h"
+#include <iostream>
+
+const int NUM_COUNTS = 14;
+const int NUM_TIMES = 4;
+
+SearchStats::SearchStats() {
+    clear();
+}
+
+void SearchStats::clear() {
+    nodes = 0;
+    quiescenceNodes = 0;
+    leafEvaluations = 0;
+    cutoffs = 0;
+    firstMoveCutoffs = 0;
+    ttProbes = 0;
+    ttHits = 0;
+    boundsReceived = 0;
+    abandonedSubtrees = 0;
+    nullMovePrunes = 0;
+    reductions = 0;
+    reSearches = 0;
+    staticPrunes = 0;
+    futilityPrunes = 0;
+    commTime = 0;
+    waitTime = 0;
+    splitTime = 0;
+    idleTime = 0;
+}
+
+void SearchStats::add(const SearchStats& other) {
+    nodes += other.nodes;
+    quiescenceNodes += other.quiescenceNodes;
+    leafEvaluations += other.leafEvaluations;
+    cutoffs += other.cutoffs;
+    firstMoveCutoffs += other.firstMoveCutoffs;
+    ttProbes += other.ttProbes;
+    ttHits += other.ttHits;
+    boundsReceived += other.boundsReceived;
+    abandonedSubtrees += other.abandonedSubtrees;
+    nullMovePrunes += other.nullMovePrunes;
+    reductions += other.reductions;
+    reSearches += other.reSearches;
+    staticPrunes += other.staticPrunes;
+    futilityPrunes += other.futilityPrunes;
+    commTime += other.commTime;
+    waitTime += other.waitTime;
+    splitTime += other.splitTime;
+    idleTime += other.idleTime;
+}
+
+/**
+ * Sums the statistics of every process in comm into total on process 0. The
+ * times in total are summed too, and the most any one process spent is
+ * returned separately, since the slowest process holds up the rest.
+ */
+void SearchStats::reduce(SearchStats& total, double& maxCommTime, double& maxWaitTime, double& maxSplitTime, double& maxIdleTime, MPI_Comm comm) const {
+    long counts[NUM_COUNTS] = { nodes, quiescenceNodes, leafEvaluations, cutoffs, firstMoveCutoffs, ttProbes, ttHits, boundsReceived, abandonedSubtrees, nullMovePrunes, reductions, reSearches, staticPrunes, futilityPrunes };
+    double times[NUM_TIMES] = { commTime, waitTime, splitTime, idleTime };
+    long totalCounts[NUM_COUNTS];
+    double totalTimes[NUM_TIMES];
+    double maxTimes[NUM_TIMES];
+
+    MPI_Reduce(counts, totalCounts, NUM_COUNTS, MPI_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(times, totalTimes, NUM_TIMES, MPI_DOUBLE, MPI_SUM, 0, comm);
+    MPI_Reduce(times, maxTimes, NUM_TIMES, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+    total.nodes = totalCounts[0];
+    total.quiescenceNodes = totalCounts[1];
+    total.leafEvaluations = totalCounts[2];
+    total.cutoffs = totalCounts[3];
+    total.firstMoveCutoffs = totalCounts[4];
+    total.ttProbes = totalCounts[5];
+    total.ttHits = totalCounts[6];
+    total.boundsReceived = totalCounts[7];
+    total.abandonedSubtrees = totalCounts[8];
+    total.nullMovePrunes = totalCounts[9];
+    total.reductions = totalCounts[10];
+    total.reSearches = totalCounts[11];
+    total.staticPrunes = totalCounts[12];
+    total.futilityPrunes = totalCounts[13];
+    total.commTime = totalTimes[0];
+    total.waitTime = totalTimes[1];
+    total.splitTime = totalTimes[2];
+    total.idleTime = totalTimes[3];
+    maxCommTime = maxTimes[0];
+    maxWaitTime = maxTimes[1];
+    maxSplitTime = maxTimes[2];
+    maxIdleTime = maxTimes[3];
+}
+
+static double percent(long part, long whole) {
+    return (whole > 0) ? 100.0 * part / whole : 0;
+}
+
+/**
+ * Combines the statistics over comm and prints them on process 0. elapsed is
+ * the wall clock time of the search. Collective over comm.
+ */
+void SearchStats::print(double elapsed, MPI_Comm comm) const {
+    int procID;
+    int nproc;
+    MPI_Comm_rank(comm, &procID);
+    MPI_Comm_size(comm, &nproc);
+
+    SearchStats total;
+    double maxCommTime;
+    double maxWaitTime;
+    double maxSplitTime;
+    double maxIdleTime;
+    reduce(total, maxCommTime, maxWaitTime, maxSplitTime, maxIdleTime, comm);
+
+    if (procID != 0) {
+        return;
+    }
+
+    long allNodes = total.nodes + total.quiescenceNodes;
+    std::cout << "Search statistics over " << nproc << " processes:" << std::endl;
+    std::cout << "  Nodes: " << allNodes << " (" << (long)(elapsed > 0 ? allNodes / elapsed : 0) << " per second), "
+              << total.quiescenceNodes << " in quiescence search" << std::endl;
+    std::cout << "  Leaf evaluations: " << total.leafEvaluations << std::endl;
+    std::cout << "  Cutoffs: " << total.cutoffs << " (" << percent(total.firstMoveCutoffs, total.cutoffs) << "% on the first move)" << std::endl;
+    std::cout << "  Transposition table: " << total.ttProbes << " probes (" << percent(total.ttHits, total.ttProbes) << "% hits)" << std::endl;
+    std::cout << "  Null-move prunes: " << total.nullMovePrunes << ", late move reductions: " << total.reductions << " ("
+              << percent(total.reSearches, total.reductions) << "% searched again)" << std::endl;
+    std::cout << "  Frontier pruning: " << total.staticPrunes << " nodes by static score, " << total.futilityPrunes << " moves by futility" << std::endl;
+    std::cout << "  Shared bounds: " << total.boundsReceived << " received, " << total.abandonedSubtrees << " subtrees abandoned" << std::endl;
+    std::cout << "  MPI time, total (slowest process): communication " << total.commTime << "s (" << maxCommTime
+              << "s), waiting " << total.waitTime << "s (" << maxWaitTime << "s), splitting " << total.splitTime << "s ("
+              << maxSplitTime << "s), idle " << total.idleTime << "s (" << maxIdleTime << "s)" << std::endl;
+}
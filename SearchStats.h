@@ -0,0 +1,39 @@
+/**
+ * @file SearchStats.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include "mpi.h"
+
+/**
+ * Counters kept by each process (and each thread's Board) during a search.
+ * Times are in seconds.
+ */
+struct SearchStats {
+    long nodes;                 // Main search nodes
+    long quiescenceNodes;
+    long leafEvaluations;       // Calls to calculateScore
+    long cutoffs;
+    long firstMoveCutoffs;      // Cutoffs caused by the first move searched
+    long ttProbes;
+    long ttHits;
+    long boundsReceived;        // Scores shared by other processes
+    long abandonedSubtrees;     // Subtrees stopped by another process's cutoff
+    long nullMovePrunes;
+    long reductions;            // Moves searched with late move reductions
+    long reSearches;            // Reduced moves searched again at full depth
+    long staticPrunes;          // Nodes cut off by reverse futility or razoring
+    long futilityPrunes;        // Quiet moves skipped by futility pruning
+    double commTime;            // Combining results in collectives
+    double waitTime;            // Waiting for results from other processes
+    double splitTime;           // Splitting communicators
+    double idleTime;            // Waiting for work to be handed out
+
+    SearchStats();
+    void clear();
+    void add(const SearchStats& other);
+    void reduce(SearchStats& total, double& maxCommTime, double& maxWaitTime, double& maxSplitTime, double& maxIdleTime, MPI_Comm comm) const;
+    void print(double elapsed, MPI_Comm comm) const;
+};
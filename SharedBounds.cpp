@@ -0,0 +1,184 @@
+/**
+ * @file SharedBounds.cpp
+ * @author Greg Loose (gloose)
+ * @brief Sharing results between the processes that split up a node in
+ * Board::findBestMove. Without this, each process only narrows the node's
+ * (alpha, beta) window with the scores of its own moves, and nobody hears
+ * about anyone else's until the MPI_Allreduce at the end, so a process that
+ * refutes the node can't stop the others from finishing work that no longer
+ * matters.
+ *
+ * Instead, whenever a process finds a new best move at the node, it sends the
+ * score to every other process with MPI_Isend. The others check for these
+ * messages with MPI_Iprobe between their moves and every BOUND_POLL_INTERVAL
+ * nodes of their subtrees, and narrow the node's window with them. Every node
+ * of a subtree below the shared node narrows its own window the same way, so
+ * a better bound from another process starts pruning straight away. If the
+ * window closes, the node is cut off, and the subtree being searched is
+ * abandoned.
+ *
+ * The messages are small and rare, since a node's best move only improves a
+ * few times. Before the result is combined, the processes agree on how many
+ * messages each one sent, and receive any still outstanding, so that none are
+ * left over to be mistaken for messages about a later node.
+ *
+ * @date 2022-05-04
+ */
+
+#include "SharedBounds.h"
+#include <limits>
+
+#define infty std::numeric_limits<double>::infinity()
+
+// Distinct from the Scheduler's tags, in case both are ever used on one
+// communicator.
+const int TAG_BOUND = 4;
+
+/**
+ * Starts sharing the window of a node where color is to move, searched with
+ * the window (a, b), between the processes in c.
+ */
+SharedBounds::SharedBounds(MPI_Comm c, Color color, double a, double b) {
+    comm = c;
+    MPI_Comm_rank(comm, &procID);
+    MPI_Comm_size(comm, &nproc);
+    toMove = color;
+    alpha = a;
+    beta = b;
+    bestValue = (toMove == WHITE) ? -infty : infty;
+    published = 0;
+    received.assign(nproc, 0);
+}
+
+/**
+ * Takes a score for move into account, from this process or another. Returns
+ * whether it is the node's new best move.
+ */
+bool SharedBounds::improve(double value, Move move) {
+    if (toMove == WHITE) {
+        if (value <= bestValue) {
+            return false;
+        }
+        bestValue = value;
+        if (bestValue > alpha) {
+            alpha = bestValue;
+        }
+    } else {
+        if (value >= bestValue) {
+            return false;
+        }
+        bestValue = value;
+        if (bestValue < beta) {
+            beta = bestValue;
+        }
+    }
+    bestMove = move;
+    return true;
+}
+
+/**
+ * Takes the score of one of this process's moves into account, and tells
+ * the other processes if it is the best so far. Returns whether it was.
+ */
+bool SharedBounds::offer(double value, Move move) {
+    if (!improve(value, move)) {
+        return false;
+    }
+
+    sendBuffers.push_back(std::pair<double, int>(value, move.compress()));
+    published ++;
+    for (int i = 0; i < nproc; i ++) {
+        if (i == procID) {
+            continue;
+        }
+        MPI_Request request;
+        MPI_Isend(&sendBuffers.back(), 1, MPI_DOUBLE_INT, i, TAG_BOUND, comm, &request);
+        requests.push_back(request);
+    }
+    return true;
+}
+
+/**
+ * Takes in every score other processes have sent so far, without waiting.
+ * Returns how many there were.
+ */
+int SharedBounds::poll() {
+    int count = 0;
+    while (true) {
+        int flag;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_BOUND, comm, &flag, &status);
+        if (!flag) {
+            return count;
+        }
+
+        std::pair<double, int> message;
+        MPI_Recv(&message, 1, MPI_DOUBLE_INT, status.MPI_SOURCE, TAG_BOUND, comm, MPI_STATUS_IGNORE);
+        received[status.MPI_SOURCE] ++;
+        improve(message.first, Move(message.second));
+        count ++;
+    }
+}
+
+/**
+ * Narrows the window (a, b) of a node below the shared one to the shared
+ * node's window. Every line through the shared node has to fall inside it to
+ * make a difference at the root.
+ */
+void SharedBounds::narrow(double& a, double& b) const {
+    if (alpha > a) {
+        a = alpha;
+    }
+    if (beta < b) {
+        b = beta;
+    }
+}
+
+/**
+ * Has the shared node been cut off, by this process or another?
+ */
+bool SharedBounds::isClosed() const {
+    return alpha >= beta;
+}
+
+double SharedBounds::getAlpha() const {
+    return alpha;
+}
+
+double SharedBounds::getBeta() const {
+    return beta;
+}
+
+double SharedBounds::getBestValue() const {
+    return bestValue;
+}
+
+Move SharedBounds::getBestMove() const {
+    return bestMove;
+}
+
+/**
+ * Receives every message still on its way, and waits for this process's own
+ * to be delivered. Collective over comm, and must be called before the
+ * processes combine their results.
+ */
+void SharedBounds::finish() {
+    std::vector<int> sent(nproc);
+    MPI_Allgather(&published, 1, MPI_INT, sent.data(), 1, MPI_INT, comm);
+
+    for (int i = 0; i < nproc; i ++) {
+        if (i == procID) {
+            continue;
+        }
+        while (received[i] < sent[i]) {
+            std::pair<double, int> message;
+            MPI_Recv(&message, 1, MPI_DOUBLE_INT, i, TAG_BOUND, comm, MPI_STATUS_IGNORE);
+            received[i] ++;
+            improve(message.first, Move(message.second));
+        }
+    }
+
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    requests.clear();
+    sendBuffers.clear();
+}
@@ -0,0 +1,46 @@
+/**
+ * @file SharedBounds.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include <vector>
+#include <deque>
+#include <utility>
+#include "Piece.h"
+#include "Move.h"
+#include "mpi.h"
+
+/**
+ * The (alpha, beta) window of a node whose moves are dealt out between the
+ * processes in comm, kept up to date with every process's results as they
+ * come in (see SharedBounds.cpp).
+ */
+class SharedBounds {
+private:
+    MPI_Comm comm;
+    int procID;
+    int nproc;
+    Color toMove;
+    double alpha;
+    double beta;
+    double bestValue;
+    Move bestMove;
+    int published;
+    std::vector<int> received;
+    std::deque<std::pair<double, int> > sendBuffers;
+    std::vector<MPI_Request> requests;
+    bool improve(double value, Move move);
+public:
+    SharedBounds(MPI_Comm c, Color color, double a, double b);
+    bool offer(double value, Move move);
+    int poll();
+    void narrow(double& a, double& b) const;
+    bool isClosed() const;
+    double getAlpha() const;
+    double getBeta() const;
+    double getBestValue() const;
+    Move getBestMove() const;
+    void finish();
+};
@@ -0,0 +1,150 @@
+/**
+ * @file Trace.cpp
+ * @author Greg Loose (gloose)
+ * @brief A timeline of the parallel search, enabled with -T. Each process
+ * records a span for every stretch of time it spends searching a position,
+ * splitting communicators, waiting in a collective or for other processes,
+ * and searching a subtree alone. At the end of the run, process 0 gathers
+ * every process's spans and writes them to one file in the Chrome trace
+ * event format, which can be opened in chrome://tracing or
+ * https://ui.perfetto.dev. Each process is shown as its own row, so load
+ * imbalance shows up as gaps in some rows and long collective waits in the
+ * others.
+ *
+ * Times come from MPI_Wtime, which need not agree between machines, so every
+ * process measures them from a barrier at the start of the trace instead.
+ *
+ * @date 2022-05-04
+ */
+
+#include "Trace.h"
+#include <climits>
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+/**
+ * Starts the trace. Collective over comm.
+ */
+Trace::Trace(MPI_Comm comm) {
+    MPI_Barrier(comm);
+    origin = MPI_Wtime();
+    dropped = 0;
+}
+
+/**
+ * Records a span from start to end, both MPI_Wtime times. detail is shown
+ * when the span is selected, e.g. the move being searched.
+ */
+void Trace::record(const char* name, double start, double end, const std::string& detail) {
+    if (events.size() >= MAX_TRACE_EVENTS) {
+        dropped ++;
+        return;
+    }
+
+    TraceEvent event;
+    event.name = name;
+    event.start = start - origin;
+    event.duration = end - start;
+    event.detail = detail;
+    events.push_back(event);
+}
+
+/**
+ * Writes text as the inside of a JSON string, escaping quotes, backslashes and
+ * control characters.
+ */
+static void writeEscaped(std::ostream& out, const std::string& text) {
+    for (int i = 0; i < text.size(); i ++) {
+        unsigned char c = text[i];
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+}
+
+/**
+ * Gathers the spans of every process in comm and writes them to filename on
+ * process 0. Collective over comm.
+ */
+void Trace::write(const char* filename, MPI_Comm comm) {
+    int procID;
+    int nproc;
+    MPI_Comm_rank(comm, &procID);
+    MPI_Comm_size(comm, &nproc);
+
+    // Each process writes its own events, and process 0 pastes them together.
+    // Chrome wants times in microseconds. MPI counts the gathered bytes in an
+    // int, so each process sends at most its share of INT_MAX and drops the
+    // events past that.
+    size_t maxLength = INT_MAX / nproc;
+    std::ostringstream out;
+    out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << procID
+        << ", \"args\": {\"name\": \"rank " << procID << "\"}}";
+    std::string local = out.str();
+    for (int i = 0; i < events.size(); i ++) {
+        char times[64];
+        snprintf(times, sizeof(times), "%.3f, \"dur\": %.3f", events[i].start * 1e6, events[i].duration * 1e6);
+        std::ostringstream event;
+        event << ",\n{\"name\": \"" << events[i].name << "\", \"ph\": \"X\", \"ts\": " << times
+              << ", \"pid\": " << procID << ", \"tid\": 0";
+        if (!events[i].detail.empty()) {
+            event << ", \"args\": {\"detail\": \"";
+            writeEscaped(event, events[i].detail);
+            event << "\"}";
+        }
+        event << "}";
+
+        std::string text = event.str();
+        if (local.size() + text.size() > maxLength) {
+            dropped += events.size() - i;
+            break;
+        }
+        local += text;
+    }
+
+    int length = local.size();
+    std::vector<int> lengths(nproc);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, comm);
+
+    std::vector<int> offsets(nproc, 0);
+    int total = 0;
+    for (int i = 0; i < nproc; i ++) {
+        offsets[i] = total;
+        total += lengths[i];
+    }
+    std::vector<char> all(procID == 0 ? total : 0);
+    MPI_Gatherv(&local[0], length, MPI_CHAR, all.data(), lengths.data(), offsets.data(), MPI_CHAR, 0, comm);
+
+    long totalDropped;
+    MPI_Reduce(&dropped, &totalDropped, 1, MPI_LONG, MPI_SUM, 0, comm);
+
+    if (procID != 0) {
+        return;
+    }
+
+    std::ofstream file(filename);
+    if (!file) {
+        std::cerr << "Could not write trace to " << filename << std::endl;
+        return;
+    }
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (int i = 0; i < nproc; i ++) {
+        if (i > 0) {
+            file << ",\n";
+        }
+        file.write(all.data() + offsets[i], lengths[i]);
+    }
+    file << "\n]}\n";
+
+    if (totalDropped > 0) {
+        std::cerr << "Trace was full, " << totalDropped << " events were dropped" << std::endl;
+    }
+}
@@ -0,0 +1,35 @@
+/**
+ * @file Trace.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include <vector>
+#include <string>
+#include "mpi.h"
+
+// Events past this many are dropped, so that a long run can't use up all the
+// memory. Each event takes a few dozen bytes.
+const int MAX_TRACE_EVENTS = 1 << 20;
+
+struct TraceEvent {
+    const char* name;
+    double start;       // Seconds since the trace started
+    double duration;
+    std::string detail;
+};
+
+/**
+ * A timeline of what one process did during its searches (see Trace.cpp).
+ */
+class Trace {
+private:
+    std::vector<TraceEvent> events;
+    double origin;
+    long dropped;
+public:
+    Trace(MPI_Comm comm);
+    void record(const char* name, double start, double end, const std::string& detail = "");
+    void write(const char* filename, MPI_Comm comm);
+};
@@ -0,0 +1,248 @@
+/**
+ * @file TranspositionTable.cpp
+ * @author Greg Loose (gloose)
+ * @brief A fixed-size hash table of search results, indexed by the Zobrist
+ * hash of the position. The same position is often reached by several move
+ * orders, and with this table it only needs to be searched once.
+ *
+ * The table is an array of buckets of TT_BUCKET_SIZE entries, sized so that a
+ * bucket fills a 64-byte cache line. Each entry's data word is packed as:
+ *
+ *   bits  0-31: score, as a float
+ *   bits 32-47: best move, as packed by Move
+ *   bits 48-55: search depth
+ *   bits 56-57: bound type
+ *   bits 58-63: generation (which search stored it)
+ *
+ * When a bucket is full, the entry replaced is the one with the lowest depth,
+ * counting entries left over from earlier searches as shallower, so that
+ * expensive deep results survive the flood of shallow ones.
+ *
+ * With the MPI constructor, one table is shared by every process on the same
+ * machine, in an MPI-3 shared memory window, so that processes can use each
+ * other's results. Processes read and write entries with no locking. Instead,
+ * the first word of an entry holds the hash key XORed with the data word. A
+ * reader that sees one word from one write and the other word from another
+ * (or a half-written entry) recovers a key that does not match, and treats
+ * the entry as a miss.
+ *
+ * @date 2022-05-04
+ */
+
+#include "TranspositionTable.h"
+#include <string.h>
+#include <stdlib.h>
+
+const int GENERATION_MASK = 0x3F;
+
+static uint64_t packMove(Move move) {
+    return (uint64_t)move.compress();
+}
+
+static Move unpackMove(uint64_t packed) {
+    return Move((int)(packed & 0xFFFF));
+}
+
+static uint64_t packData(double score, Bound bound, int depth, Move move, int generation) {
+    float f = (float)score;
+    uint32_t scoreBits;
+    memcpy(&scoreBits, &f, sizeof(scoreBits));
+    return (uint64_t)scoreBits
+        | (packMove(move) << 32)
+        | ((uint64_t)(depth & 0xFF) << 48)
+        | ((uint64_t)bound << 56)
+        | ((uint64_t)(generation & GENERATION_MASK) << 58);
+}
+
+static int dataDepth(uint64_t data) {
+    return (data >> 48) & 0xFF;
+}
+
+static Bound dataBound(uint64_t data) {
+    return (Bound)((data >> 56) & 0x3);
+}
+
+static int dataGeneration(uint64_t data) {
+    return (data >> 58) & GENERATION_MASK;
+}
+
+static size_t bucketsFor(int megabytes) {
+    size_t numBuckets = ((size_t)megabytes << 20) / sizeof(TTBucket);
+    if (numBuckets == 0) {
+        numBuckets = 1;
+    }
+    return numBuckets;
+}
+
+/**
+ * Creates a table private to this process.
+ */
+TranspositionTable::TranspositionTable(int megabytes) {
+    numBuckets = bucketsFor(megabytes);
+    buckets = new TTBucket[numBuckets];
+    clear();
+}
+
+/**
+ * Creates one table shared by all processes in comm that can share memory
+ * with each other. This is collective over comm. The memory is allocated by
+ * the lowest ranked process on each machine, and the others map it.
+ */
+TranspositionTable::TranspositionTable(int megabytes, MPI_Comm comm) {
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+
+    int nodeRank;
+    MPI_Comm_rank(nodeComm, &nodeRank);
+
+    numBuckets = bucketsFor(megabytes);
+    MPI_Aint size = (nodeRank == 0) ? numBuckets * sizeof(TTBucket) : 0;
+    void* base;
+    MPI_Win_allocate_shared(size, sizeof(TTBucket), MPI_INFO_NULL, nodeComm, &base, &window);
+
+    MPI_Aint sharedSize;
+    int dispUnit;
+    MPI_Win_shared_query(window, 0, &sharedSize, &dispUnit, &base);
+    buckets = (TTBucket*)base;
+
+    // Entries are read and written directly through the pointer, without
+    // MPI calls, for as long as the table exists.
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+
+    if (nodeRank == 0) {
+        clear();
+    }
+    MPI_Win_sync(window);
+    MPI_Barrier(nodeComm);
+}
+
+TranspositionTable::~TranspositionTable() {
+    if (window != MPI_WIN_NULL) {
+        MPI_Win_unlock_all(window);
+        MPI_Win_free(&window);
+        MPI_Comm_free(&nodeComm);
+    } else {
+        delete[] buckets;
+    }
+}
+
+void TranspositionTable::clear() {
+    memset(buckets, 0, numBuckets * sizeof(TTBucket));
+}
+
+/**
+ * Empties the table between unrelated searches, so that each starts from
+ * scratch. For a shared table this is collective over the communicator it
+ * was made with, and the table is cleared once per machine.
+ */
+void TranspositionTable::reset() {
+    generation = 0;
+    if (window == MPI_WIN_NULL) {
+        clear();
+        return;
+    }
+
+    int nodeRank;
+    MPI_Comm_rank(nodeComm, &nodeRank);
+
+    MPI_Barrier(nodeComm);
+    if (nodeRank == 0) {
+        clear();
+    }
+    MPI_Win_sync(window);
+    MPI_Barrier(nodeComm);
+}
+
+/**
+ * Entries may be written by other processes at any time, so each word is
+ * loaded and stored exactly once per access.
+ */
+static void loadEntry(TTEntry& entry, uint64_t& key, uint64_t& data) {
+    uint64_t check = __atomic_load_n(&entry.key, __ATOMIC_RELAXED);
+    data = __atomic_load_n(&entry.data, __ATOMIC_RELAXED);
+    key = check ^ data;
+}
+
+static void saveEntry(TTEntry& entry, uint64_t key, uint64_t data) {
+    __atomic_store_n(&entry.key, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry.data, data, __ATOMIC_RELAXED);
+}
+
+/**
+ * Called before each search, so that entries from earlier searches are
+ * replaced first.
+ */
+void TranspositionTable::newSearch() {
+    generation = (generation + 1) & GENERATION_MASK;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTResult& result) {
+    TTBucket& bucket = buckets[key % numBuckets];
+    for (int i = 0; i < TT_BUCKET_SIZE; i ++) {
+        uint64_t entryKey;
+        uint64_t data;
+        loadEntry(bucket.entries[i], entryKey, data);
+        if (entryKey == key && dataBound(data) != BOUND_NONE) {
+            uint32_t scoreBits = (uint32_t)data;
+            float f;
+            memcpy(&f, &scoreBits, sizeof(f));
+            result.score = f;
+            result.bound = dataBound(data);
+            result.depth = dataDepth(data);
+            result.move = unpackMove(data >> 32);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, double score, Bound bound, int depth, Move move) {
+    TTBucket& bucket = buckets[key % numBuckets];
+
+    TTEntry* replace = &bucket.entries[0];
+    int replaceValue = 1 << 30;
+    for (int i = 0; i < TT_BUCKET_SIZE; i ++) {
+        TTEntry& entry = bucket.entries[i];
+        uint64_t entryKey;
+        uint64_t data;
+        loadEntry(entry, entryKey, data);
+        if (entryKey == key) {
+            // Keep a deeper result for the same position unless this one
+            // is exact, but still remember the newer best move.
+            if (bound != BOUND_EXACT && depth < dataDepth(data)) {
+                if (move.isNull()) {
+                    return;
+                }
+                saveEntry(entry, key, (data & ~(0xFFFFULL << 32)) | (packMove(move) << 32));
+                return;
+            }
+            replace = &entry;
+            break;
+        }
+
+        int age = (generation - dataGeneration(data)) & GENERATION_MASK;
+        int value = dataDepth(data) - 8 * age;
+        if (dataBound(data) == BOUND_NONE) {
+            value = -(1 << 30);
+        }
+        if (value < replaceValue) {
+            replace = &entry;
+            replaceValue = value;
+        }
+    }
+
+    saveEntry(*replace, key, packData(score, bound, depth, move, generation));
+}
+
+/**
+ * Mate scores count the remaining depth at which the mate happens (see
+ * Board::findBestMove), so a mate stored from a deeper search has to be
+ * shifted to be comparable with scores at the current depth.
+ */
+double TranspositionTable::scoreFromTT(double score, int storedDepth, int depth) {
+    if (score >= MATE_THRESHOLD) {
+        return score - (storedDepth - depth);
+    } else if (score <= -MATE_THRESHOLD) {
+        return score + (storedDepth - depth);
+    }
+    return score;
+}
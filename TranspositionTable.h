@@ -0,0 +1,77 @@
+/**
+ * @file TranspositionTable.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "Move.h"
+#include "mpi.h"
+
+const int DEFAULT_TT_MEGABYTES = 64;
+const int TT_BUCKET_SIZE = 4;
+
+// Any score at least this large in magnitude is a forced checkmate.
+const double MATE_THRESHOLD = 900;
+
+/**
+ * How a stored score relates to the true value of the position: exactly equal,
+ * at most (UPPER), or at least (LOWER). Scores are always from White's
+ * perspective, as elsewhere in Board.
+ */
+enum Bound {
+    BOUND_NONE,
+    BOUND_UPPER,
+    BOUND_LOWER,
+    BOUND_EXACT
+};
+
+/**
+ * One stored search result. The hash key is kept alongside so that
+ * collisions between positions sharing a bucket can be detected; everything
+ * else is packed into the second word (see TranspositionTable.cpp). The key
+ * is stored XORed with the data, to detect entries torn by concurrent writes.
+ */
+struct TTEntry {
+    uint64_t key;
+    uint64_t data;
+};
+
+/**
+ * A group of entries sharing one cache line. A position may be stored in any
+ * entry of the bucket its hash selects.
+ */
+struct TTBucket {
+    TTEntry entries[TT_BUCKET_SIZE];
+};
+
+/**
+ * The unpacked contents of an entry, returned by probe.
+ */
+struct TTResult {
+    double score;
+    Bound bound;
+    int depth;
+    Move move;
+};
+
+class TranspositionTable {
+private:
+    TTBucket* buckets;
+    size_t numBuckets;
+    int generation = 0;
+    MPI_Win window = MPI_WIN_NULL;
+    MPI_Comm nodeComm = MPI_COMM_NULL;
+public:
+    TranspositionTable(int megabytes);
+    TranspositionTable(int megabytes, MPI_Comm comm);
+    ~TranspositionTable();
+    void clear();
+    void reset();
+    void newSearch();
+    bool probe(uint64_t key, TTResult& result);
+    void store(uint64_t key, double score, Bound bound, int depth, Move move);
+    static double scoreFromTT(double score, int storedDepth, int depth);
+};
@@ -0,0 +1,65 @@
+/**
+ * @file Zobrist.cpp
+ * @author Greg Loose (gloose)
+ * @brief Random keys for Zobrist hashing of board positions. A position's
+ * hash is the XOR of the key for every (color, piece, square) on the board,
+ * plus keys for each castling right still available, the column (if any)
+ * that can be captured en passant, and the side to move. Since XOR is its own
+ * inverse, Board can update the hash incrementally as pieces come and go.
+ *
+ * The keys come from a fixed seed, so every process computes the same hash
+ * for the same position.
+ *
+ * @date 2022-05-04
+ */
+
+#include "Zobrist.h"
+
+uint64_t zobristPieces[3][7][WIDTH * HEIGHT];
+uint64_t zobristCastling[4];
+uint64_t zobristEnPassant[3][WIDTH + 1];
+uint64_t zobristBlackToMove;
+
+/**
+ * xorshift64* generator (Vigna), which is plenty random for hash keys.
+ */
+static uint64_t nextRandom(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+void initZobrist() {
+    uint64_t state = 1070372ULL;
+
+    for (int c = 0; c < 3; c ++) {
+        for (int t = 0; t < 7; t ++) {
+            for (int sq = 0; sq < WIDTH * HEIGHT; sq ++) {
+                // Empty squares never contribute to the hash.
+                if (c == NOCOLOR || t == NONE) {
+                    zobristPieces[c][t][sq] = 0;
+                } else {
+                    zobristPieces[c][t][sq] = nextRandom(state);
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < 4; i ++) {
+        zobristCastling[i] = nextRandom(state);
+    }
+
+    for (int c = 0; c < 3; c ++) {
+        for (int col = 0; col <= WIDTH; col ++) {
+            // Column 0 means en passant is not possible.
+            if (c == NOCOLOR || col == 0) {
+                zobristEnPassant[c][col] = 0;
+            } else {
+                zobristEnPassant[c][col] = nextRandom(state);
+            }
+        }
+    }
+
+    zobristBlackToMove = nextRandom(state);
+}
@@ -0,0 +1,17 @@
+/**
+ * @file Zobrist.h
+ * @author Greg Loose (gloose)
+ * @date 2022-05-04
+ */
+
+#pragma once
+#include <stdint.h>
+#include "Piece.h"
+#include "Position.h"
+
+extern uint64_t zobristPieces[3][7][WIDTH * HEIGHT];
+extern uint64_t zobristCastling[4];
+extern uint64_t zobristEnPassant[3][WIDTH + 1];
+extern uint64_t zobristBlackToMove;
+
+void initZobrist();
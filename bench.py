@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+Runs the search benchmark (Board -b, see Bench.cpp) with 1, 2, ..., N
+processes and prints a table of the speedup and efficiency of each run over
+the run with 1 process, both for each position and in total.
+
+    python3 bench.py --max-ranks 8 --depth 6 inputs/*.txt
+
+The JSON from every run is also saved as bench-<ranks>.json. Any arguments
+after -- are passed on to Board, e.g. -- -w -j 2.
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+
+
+def run(ranks, depth, files, extra, mpirun):
+    command = mpirun + ["-np", str(ranks), "./Board", "-b", "-d", str(depth)] + extra + files
+    output = subprocess.run(command, stdout=subprocess.PIPE, check=True, universal_newlines=True).stdout
+    with open("bench-%d.json" % ranks, "w") as f:
+        f.write(output)
+    return json.loads(output)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure how the search scales with the number of processes.")
+    parser.add_argument("--max-ranks", type=int, default=4)
+    parser.add_argument("--depth", type=int, default=5)
+    parser.add_argument("--mpirun", default="mpirun", help="command used to launch Board, e.g. 'srun' or 'mpirun --oversubscribe'")
+    parser.add_argument("files", nargs="+")
+    args, extra = parser.parse_known_args()
+    if extra and extra[0] == "--":
+        extra = extra[1:]
+
+    runs = []
+    for ranks in range(1, args.max_ranks + 1):
+        print("Running with %d rank%s..." % (ranks, "" if ranks == 1 else "s"), file=sys.stderr)
+        runs.append(run(ranks, args.depth, args.files, extra, args.mpirun.split()))
+
+    base = runs[0]
+    names = [p["file"] for p in base["positions"]]
+    width = max(len(name) for name in names + ["total"])
+
+    print("Speedup (efficiency) over 1 rank, depth %d" % args.depth)
+    print("%-*s" % (width, "position") + "".join("%16s" % ("%d ranks" % r["ranks"]) for r in runs))
+    for i, name in enumerate(names):
+        row = "%-*s" % (width, name)
+        for r in runs:
+            speedup = base["positions"][i]["time"] / r["positions"][i]["time"]
+            row += "%16s" % ("%.2f (%.0f%%)" % (speedup, 100 * speedup / r["ranks"]))
+        print(row)
+
+    row = "%-*s" % (width, "total")
+    for r in runs:
+        speedup = base["totalTime"] / r["totalTime"]
+        row += "%16s" % ("%.2f (%.0f%%)" % (speedup, 100 * speedup / r["ranks"]))
+    print(row)
+
+    print()
+    print("Nodes searched, relative to 1 rank (search overhead)")
+    row = "%-*s" % (width, "total")
+    for r in runs:
+        row += "%16s" % ("%.2f" % (r["totalNodes"] / base["totalNodes"]))
+    print(row)
+
+
+if __name__ == "__main__":
+    main()